@@ -12,6 +12,9 @@ namespace es
 
 class Entity;
 
+template <class T>
+class ComponentArray;
+
 /*
 Base component class. All components must inherit from this.
 */
@@ -62,6 +65,9 @@ class Component
         es::ID ownerId{es::invalidId};
 
         friend class Entity;
+
+        template <class T>
+        friend class ComponentArray;
 };
 
 }
@@ -5,9 +5,14 @@
 #define ES_COMPONENTPOOL_H
 
 #include <typeindex>
-#include <unordered_set>
 #include <unordered_map>
+#include <vector>
+#include <deque>
 #include <memory>
+#include <memory_resource>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <cassert>
 #include <es/internal/componentarray.h>
 
@@ -27,15 +32,24 @@ struct TypeIndex
 Each instance of ComponentPool stores its own components.
     Each component type is stored in a separate PackedArray.
     Base component arrays can be accessed by component name or type index.
+    Arrays are only created when a component type is first used, so creating
+        a pool doesn't depend on the number of registered types.
+    The registry of component types is shared by all pools, and is safe to use
+        from multiple threads. Types should be registered at startup, after
+        that the registry is only read from.
 */
 class ComponentPool
 {
     public:
 
         ComponentPool();
+
+        // All components are allocated from the memory resource
+        explicit ComponentPool(std::pmr::memory_resource* resource);
+
         ~ComponentPool();
 
-        // Registers a new component type and it's name
+        // Registers a new component type and it's name (thread safe)
         template <typename T>
         static void registerComponent(const std::string& compName = "");
 
@@ -49,15 +63,22 @@ class ComponentPool
         static const std::string& getName(const std::type_index& typeIdx);
 
         // Returns the component array from the component's type
+        // The array is created if this pool doesn't have one yet
         template <typename T>
         ComponentArray<T>& get();
 
         // Returns the component array from the component's type
+        // If this pool doesn't have one yet, an empty array is returned
         template <typename T>
         const ComponentArray<T>& get() const;
 
-        // Returns the base componeny array from the component's type index
-        BaseComponentArray* operator[](const std::type_index& typeIdx) const;
+        // Returns the base component array from the component's type index
+        // The array is created if needed, returns nullptr for unregistered types
+        BaseComponentArray* operator[](const std::type_index& typeIdx);
+
+        // Returns the base component array from the component's type index
+        // Never creates an array, but returns an empty one for registered types
+        const BaseComponentArray* operator[](const std::type_index& typeIdx) const;
 
         // Returns the base component array from the component's name
         BaseComponentArray* operator[](const std::string& compName);
@@ -65,11 +86,28 @@ class ComponentPool
         // Returns the base component array from the component's name
         const BaseComponentArray* operator[](const std::string& compName) const;
 
-        // Clears all components, and sets up new arrays cloned from registered types
+        // Moves all components of another pool into this one, and clears the other pool
+        // Each array is appended in bulk, see BaseComponentArray::appendFrom()
+        // Calls func(typeIdx, moved) for each type, with the moved (owner ID, component ID) pairs
+        template <typename Func>
+        void appendFrom(ComponentPool& srcPool, const std::vector<ID>& ownerIds, Func func);
+
+        // Removes all components and arrays
         void reset();
 
-        // Adds any newly registered component types
-        void refresh();
+        // Returns the number of component arrays that were created
+        size_t arrayCount() const;
+
+        // Returns the lifecycle signals of a component type (they are created if needed)
+        // The signals are kept when the pool is reset
+        template <typename T>
+        ComponentSignals& getSignals();
+
+        // Returns true if the signals of any component type were created
+        bool hasSignals() const;
+
+        // Removes the tombstones of all arrays with more than maxRatio tombstones
+        void compact(float maxRatio = 0.0f, bool stable = true);
 
     private:
 
@@ -81,23 +119,55 @@ class ComponentPool
         {
             ComponentArrayPtr array;
             std::string name;
+            TypeIndex type;
         };
 
-        using TypeToInfoMap = std::unordered_map<std::type_index, ComponentInfo>;
+        using TypeToIdMap = std::unordered_map<std::type_index, size_t>;
         using NameToTypeMap = std::unordered_map<std::string, TypeIndex>;
 
         struct StaticData
         {
-            // For keeping track of ComponentPool instances
-            std::unordered_set<ComponentPool*> instances;
+            // Registered types, by type ID (in the order they were registered)
+            // Note: A deque never moves its elements, so returned names stay valid
+            std::deque<ComponentInfo> compInfo;
 
-            TypeToInfoMap compInfo;
+            TypeToIdMap typeIds;
             NameToTypeMap compTypes;
             const TypeIndex invalidType;
+
+            // Registering takes a unique lock, everything else a shared one
+            mutable std::shared_mutex mutex;
         };
 
-        // Refreshes a single array by type index and returns its pointer
-        BaseComponentArray* setupArray(const std::type_index& typeIdx, BaseComponentArray* array);
+        static constexpr size_t invalidTypeId = static_cast<size_t>(-1);
+
+        // Returns the type ID of a registered type, or invalidTypeId
+        static size_t findTypeId(const std::type_index& typeIdx);
+
+        // Same as findTypeId(), but types this pool has arrays for are found without
+            // locking the registry, so worlds on different threads don't contend on it
+        size_t findLocalTypeId(const std::type_index& typeIdx) const;
+
+        // Same as findTypeId(), but only looks it up until the type is registered
+        // After that, this is a single atomic load without any locking
+        template <typename T>
+        static size_t getTypeId();
+
+        // Returns the array of a registered type, and creates it if needed
+        BaseComponentArray* getArray(size_t typeId);
+
+        // Returns the array of a registered type, or the empty registered array
+        const BaseComponentArray* getArray(size_t typeId) const;
+
+        BaseComponentArray* createArray(size_t typeId);
+
+        ComponentSignals& getSignals(size_t typeId);
+
+        // Returns the empty registered array of a type
+        static const BaseComponentArray* getRegisteredArray(size_t typeId);
+
+        // Returns the type index of a registered type
+        static std::type_index getRegisteredType(size_t typeId);
 
         static StaticData& getStaticData();
 
@@ -105,47 +175,116 @@ class ComponentPool
         // initialized before any component pools.
         StaticData& data;
 
-        // All components are stored here, separated by type
-        std::unordered_map<std::type_index, ComponentArrayPtr> components;
+        // Where the component arrays allocate their components from
+        std::pmr::memory_resource* resource;
+
+        // All components are stored here, separated by type (indexed by type ID)
+        // Arrays that haven't been used yet are null
+        std::pmr::vector<ComponentArrayPtr> components;
+
+        // The type IDs of the arrays this pool created (filled in by createArray())
+        // Only changed by non-const functions, so const pools can be read from many threads
+        std::pmr::unordered_map<std::type_index, size_t> localTypeIds;
+
+        // Lifecycle signals of each type (indexed by type ID)
+        // Note: The arrays point to these, so they are allocated separately and never move
+        std::pmr::vector<std::unique_ptr<ComponentSignals>> componentSignals;
 };
 
 template <typename T>
 void ComponentPool::registerComponent(const std::string& compName)
 {
     std::type_index typeIdx {typeid(T)};
-    auto& info = getStaticData().compInfo[typeIdx];
-    if (!info.array)
+    auto& data = getStaticData();
+    std::unique_lock<std::shared_mutex> lock(data.mutex);
+    if (data.typeIds.find(typeIdx) == data.typeIds.end())
     {
         // Store the name -> type index
         if (!compName.empty())
-            getStaticData().compTypes[compName].id = typeIdx;
+            data.compTypes[compName].id = typeIdx;
 
         // Create an empty array, and save the component name
-        info.array = std::make_unique<ComponentArray<T>>();
-        info.name = compName;
+        // Note: Component pools create their arrays from this one when they need it
+        data.typeIds[typeIdx] = data.compInfo.size();
+        data.compInfo.push_back(ComponentInfo{std::make_unique<ComponentArray<T>>(), compName, typeIdx});
+    }
+}
 
-        // Update current ComponentPool instances with new type
-        for (auto ptr: getStaticData().instances)
-            ptr->setupArray(typeIdx, info.array.get());
+template <typename T>
+size_t ComponentPool::getTypeId()
+{
+    // Type IDs never change once registered, so relaxed ordering is enough
+    static std::atomic<size_t> cachedId {invalidTypeId};
+    size_t typeId = cachedId.load(std::memory_order_relaxed);
+    if (typeId == invalidTypeId)
+    {
+        typeId = findTypeId(typeid(T));
+        cachedId.store(typeId, std::memory_order_relaxed);
     }
+    return typeId;
+}
+
+inline BaseComponentArray* ComponentPool::getArray(size_t typeId)
+{
+    if (typeId < components.size() && components[typeId])
+        return components[typeId].get();
+    return createArray(typeId);
+}
+
+inline const BaseComponentArray* ComponentPool::getArray(size_t typeId) const
+{
+    if (typeId < components.size() && components[typeId])
+        return components[typeId].get();
+    return getRegisteredArray(typeId);
+}
+
+template <typename Func>
+void ComponentPool::appendFrom(ComponentPool& srcPool, const std::vector<ID>& ownerIds, Func func)
+{
+    std::vector<std::pair<ID, ID>> moved;
+    for (size_t typeId = 0; typeId < srcPool.components.size(); ++typeId)
+    {
+        auto& srcArray = srcPool.components[typeId];
+        if (srcArray && srcArray->size() > 0)
+        {
+            moved.clear();
+            getArray(typeId)->appendFrom(*srcArray, ownerIds, moved);
+            func(getRegisteredType(typeId), moved);
+        }
+    }
+    srcPool.reset();
 }
 
 template <typename T>
 ComponentArray<T>& ComponentPool::get()
 {
     // Only returns the array for registered types
-    auto found = components.find(typeid(T));
-    assert(found != components.end());
-    return *static_cast<ComponentArray<T>*>(found->second.get());
+    size_t typeId = getTypeId<T>();
+    assert(typeId != invalidTypeId);
+    return *static_cast<ComponentArray<T>*>(getArray(typeId));
 }
 
 template <typename T>
 const ComponentArray<T>& ComponentPool::get() const
 {
     // Only returns the array for registered types
-    auto found = components.find(typeid(T));
-    assert(found != components.end());
-    return *static_cast<const ComponentArray<T>*>(found->second.get());
+    size_t typeId = getTypeId<T>();
+    assert(typeId != invalidTypeId);
+    if (typeId < components.size() && components[typeId])
+        return *static_cast<const ComponentArray<T>*>(components[typeId].get());
+
+    // The same as the empty registered array, but without locking the registry
+    static const ComponentArray<T> emptyArray;
+    return emptyArray;
+}
+
+template <typename T>
+ComponentSignals& ComponentPool::getSignals()
+{
+    // Only returns the signals for registered types
+    size_t typeId = getTypeId<T>();
+    assert(typeId != invalidTypeId);
+    return getSignals(typeId);
 }
 
 // Registers a single component type
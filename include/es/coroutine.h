@@ -0,0 +1,339 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_COROUTINE_H
+#define ES_COROUTINE_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <es/internal/id.h>
+#include <es/internal/packedarray.h>
+#include <es/events.h>
+
+namespace es
+{
+
+class Scheduler;
+
+/*
+A coroutine that can suspend across frames, started and resumed by a Scheduler.
+    Inside a task, these suspend it until a later frame:
+        float dt = co_await es::nextFrame();
+        co_await es::seconds(0.5f);
+        auto& hits = co_await es::nextEvents(world->events().channel<Hit>());
+    Other tasks can also be awaited, which runs them as part of this one:
+        co_await searchPath(start, goal);
+An exception that escapes a task is rethrown in the task that awaited it, or from the
+    Scheduler::start() or update() call that was running the task.
+Tasks don't start until they are started by a scheduler, or awaited by another task.
+Note: The task owns the coroutine, and destroys it when the task is destroyed.
+*/
+class Task
+{
+    public:
+
+        struct promise_type;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        // Resumes the task that awaited this one, or tells the scheduler this task finished
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(Handle handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        struct promise_type
+        {
+            Task get_return_object() { return Task(Handle::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { exception = std::current_exception(); }
+
+            // Set when the task is started or awaited
+            Scheduler* scheduler{nullptr};
+            ID rootId{invalidId};
+            std::coroutine_handle<> continuation;
+
+            // Set when an exception escapes the task
+            std::exception_ptr exception;
+        };
+
+        // Runs another task as part of the awaiting task
+        // Rethrows the exception that escaped the other task, if any
+        struct Awaiter
+        {
+            bool await_ready() const { return false; }
+            std::coroutine_handle<> await_suspend(Handle parent);
+
+            void await_resume() const
+            {
+                if (handle.promise().exception)
+                    std::rethrow_exception(handle.promise().exception);
+            }
+
+            Handle handle;
+        };
+
+        Task() {}
+        explicit Task(Handle handle): handle(handle) {}
+        Task(Task&& other): handle(std::exchange(other.handle, nullptr)) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        Task& operator=(Task&& other)
+        {
+            if (this != &other)
+            {
+                reset();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task()
+        {
+            reset();
+        }
+
+        Awaiter operator co_await() &&
+        {
+            return {handle};
+        }
+
+        // Gives up ownership of the coroutine (used by Scheduler::start())
+        Handle release()
+        {
+            return std::exchange(handle, nullptr);
+        }
+
+    private:
+
+        void reset()
+        {
+            if (handle)
+                handle.destroy();
+            handle = nullptr;
+        }
+
+        Handle handle;
+};
+
+/*
+Runs tasks that suspend across frames (see Task).
+Each SystemContainer has a scheduler, which it updates at the start of updateAll().
+    Tasks waiting for the next frame are resumed in the order they suspended, then the
+        tasks whose time is up, then the tasks whose events arrived.
+    Waiting doesn't cost anything per frame, except for tasks waiting on events,
+        which check their channel once per frame.
+Not thread safe.
+*/
+class Scheduler
+{
+    public:
+
+        Scheduler();
+        ~Scheduler();
+
+        // Tasks point to their scheduler, so it can't be copied
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // Starts a task, which runs until it first suspends
+        // Returns the ID of the task, which can be cancelled
+        // Rethrows the exception that escaped the task, if it threw before suspending
+        // Note: Everything the task uses must outlive it, or the task must be cancelled first
+        ID start(Task task);
+
+        // Destroys a task that hasn't finished yet
+        // A task can cancel itself, it is destroyed the next time it suspends
+        // Returns false if the task already finished or was cancelled
+        bool cancel(ID taskId);
+
+        // Returns true if the task hasn't finished or been cancelled yet
+        bool isRunning(ID taskId) const;
+
+        // Moves forward a frame, and resumes the tasks that are done waiting
+        // Rethrows the first exception that escaped a task, after resuming the others
+        void update(float dt);
+
+        // Returns the dt of the current frame
+        float getDt() const;
+
+        // Returns the number of seconds the scheduler was updated with so far
+        double getTime() const;
+
+        // Returns the number of running tasks
+        size_t size() const;
+
+        // Destroys all tasks
+        void clear();
+
+        // Used by the awaitables ============================================
+
+        using EventCheck = bool (*)(void* channel, uint64_t frame);
+
+        void resumeNextFrame(ID rootId, std::coroutine_handle<> handle);
+        void resumeAfter(float seconds, ID rootId, std::coroutine_handle<> handle);
+        void resumeOnEvents(EventCheck check, void* channel, uint64_t frame, ID rootId, std::coroutine_handle<> handle);
+
+        // Called when a task finishes, with the exception that escaped it (if any)
+        void finish(ID rootId, std::exception_ptr taskException);
+
+    private:
+
+        struct Waiting
+        {
+            ID rootId;
+            std::coroutine_handle<> handle;
+        };
+
+        struct Timer
+        {
+            double time;
+            uint64_t order;
+            Waiting waiting;
+
+            // Sorts the heap by time, then by the order they were scheduled
+            bool operator>(const Timer& other) const
+            {
+                return (time != other.time ? time > other.time : order > other.order);
+            }
+        };
+
+        struct EventWaiting
+        {
+            EventCheck check;
+            void* channel;
+            uint64_t frame;
+            Waiting waiting;
+        };
+
+        // Destroys the tasks that finished or were cancelled, once no task is running
+        void destroyFinished();
+
+        // The coroutines of the tasks that were started
+        // Waiting tasks are looked up by ID, so cancelled tasks are skipped when they are reached
+        PackedArray<std::coroutine_handle<>> tasks;
+
+        // Tasks waiting for the next frame
+        std::vector<Waiting> ready;
+
+        // Tasks being resumed (kept to reuse the memory)
+        std::vector<Waiting> resuming;
+
+        // Tasks waiting for time to pass (a min heap)
+        std::vector<Timer> timers;
+
+        std::vector<EventWaiting> eventWaiters;
+
+        std::vector<std::coroutine_handle<>> finished;
+
+        // The first exception that escaped a task, rethrown by start() or update()
+        std::exception_ptr exception;
+
+        double time{0.0};
+        float dt{0.0f};
+        uint64_t timerOrder{0};
+
+        // The number of start() and update() calls that are resuming tasks
+        unsigned resumeDepth{0};
+};
+
+// Suspends a task until the next frame, and returns the dt of that frame
+struct FrameAwaiter
+{
+    bool await_ready() const { return false; }
+
+    void await_suspend(Task::Handle handle)
+    {
+        scheduler = handle.promise().scheduler;
+        scheduler->resumeNextFrame(handle.promise().rootId, handle);
+    }
+
+    float await_resume() const { return scheduler->getDt(); }
+
+    Scheduler* scheduler{nullptr};
+};
+
+inline FrameAwaiter nextFrame()
+{
+    return {};
+}
+
+// Suspends a task until a number of seconds passed
+struct TimeAwaiter
+{
+    bool await_ready() const { return (seconds <= 0.0f); }
+
+    void await_suspend(Task::Handle handle)
+    {
+        handle.promise().scheduler->resumeAfter(seconds, handle.promise().rootId, handle);
+    }
+
+    void await_resume() const {}
+
+    float seconds;
+};
+
+inline TimeAwaiter seconds(float seconds)
+{
+    return {seconds};
+}
+
+// Suspends a task until a later frame where the channel has events from the last frame,
+    // and returns them (see EventChannel::getPrevious())
+// Waiting on a channel in a loop sees each event exactly once
+template <class T>
+struct EventAwaiter
+{
+    bool await_ready() const { return false; }
+
+    void await_suspend(Task::Handle handle)
+    {
+        handle.promise().scheduler->resumeOnEvents(&hasNewEvents, &channel, channel.getFrame(),
+            handle.promise().rootId, handle);
+    }
+
+    const std::vector<T>& await_resume() { return channel.getPrevious(); }
+
+    static bool hasNewEvents(void* channel, uint64_t frame)
+    {
+        auto& eventChannel = *static_cast<EventChannel<T>*>(channel);
+        return (eventChannel.getFrame() > frame && !eventChannel.getPrevious().empty());
+    }
+
+    EventChannel<T>& channel;
+};
+
+template <class T>
+EventAwaiter<T> nextEvents(EventChannel<T>& channel)
+{
+    return {channel};
+}
+
+inline std::coroutine_handle<> Task::FinalAwaiter::await_suspend(Handle handle) noexcept
+{
+    auto& promise = handle.promise();
+    if (promise.continuation)
+        return promise.continuation;
+    promise.scheduler->finish(promise.rootId, promise.exception);
+    return std::noop_coroutine();
+}
+
+inline std::coroutine_handle<> Task::Awaiter::await_suspend(Handle parent)
+{
+    auto& promise = handle.promise();
+    promise.scheduler = parent.promise().scheduler;
+    promise.rootId = parent.promise().rootId;
+    promise.continuation = parent;
+    return handle;
+}
+
+}
+
+#endif
@@ -7,6 +7,10 @@
 #include <es/component.h>
 #include <es/componentpool.h>
 #include <es/internal/core.h>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <cassert>
 
 namespace es
 {
@@ -37,11 +41,41 @@ class Entity
         template <typename T>
         Entity& operator<<(const T& comp);
 
+        // Moves a component into the entity (also works with move-only components)
+        template <typename T, typename = std::enable_if_t<std::is_base_of<Component, T>::value && !std::is_const<T>::value>>
+        Entity& operator<<(T&& comp);
+
         // Deserializes component name and data
         Entity& operator<<(const std::string& data);
         Entity& operator<<(const char* data);
 
 
+        // Constructing components in place ==================================
+        // Note: Each of these only looks up the component once. New components are
+            // constructed in place from the arguments, and existing components are
+            // replaced by constructing a temporary and move assigning it.
+            // They return nullptr if the entity is invalid.
+
+        // Creates the component if it doesn't exist, otherwise leaves it as is
+        // Returns the new or existing component
+        template <typename T, typename... Args>
+        T* emplace(Args&&... args);
+
+        // Constructs the component again if it exists, otherwise does nothing
+        // Returns the replaced component, or nullptr if it doesn't exist
+        template <typename T, typename... Args>
+        T* replace(Args&&... args);
+
+        // Creates the component, or constructs it again if it already exists
+        template <typename T, typename... Args>
+        T* emplaceOrReplace(Args&&... args);
+
+        // Calls func(T&) to modify the component if it exists
+        // Returns true if the component exists
+        template <typename T, typename Func>
+        bool patch(Func func);
+
+
         // Accessing components (No automatic creation) ======================
         // Note: When the component type doesn't exist, these return an
             // invalid handle, or nullptr.
@@ -85,6 +119,9 @@ class Entity
         // Returns the names of all its components (only the ones with names)
         std::vector<std::string> getNames() const;
 
+        // Returns the names of all its components, allocated from a memory resource
+        std::pmr::vector<std::pmr::string> getNames(std::pmr::memory_resource* resource) const;
+
 
         // Accessing components (Automatic creation) =========================
 
@@ -123,6 +160,7 @@ class Entity
 
         // Returns true if the entity has these components from a type index list
         bool has(const std::vector<TypeIndex>& types) const;
+        bool has(const std::pmr::vector<TypeIndex>& types) const;
 
         // Returns true if the entity has all of the specified component names
         template <typename... Args>
@@ -167,6 +205,10 @@ class Entity
         // Copies this entity into another world, and returns it
         Entity clone(Core& newCore, const std::string& newName = "") const;
 
+        // Moves this entity into another world, and returns it
+        // Components are moved instead of copied, and this entity is destroyed
+        Entity moveTo(Core& newCore);
+
 
         // Entity information ================================================
 
@@ -200,6 +242,10 @@ class Entity
         // Serializes all components into a vector of strings (with component names)
         std::vector<std::string> serialize() const;
 
+        // Serializes all components, allocating the strings from a memory resource
+        // Note: Component::save() still returns a std::string
+        std::pmr::vector<std::pmr::string> serialize(std::pmr::memory_resource* resource) const;
+
         // Serializes a single component by type
         template <typename T>
         std::string serialize() const;
@@ -231,9 +277,30 @@ class Entity
         // Create/get component ID
         ID atCompId(const std::string& name);
 
+        // Create/get component ID from type (forwards the arguments when creating)
+        template <typename T, typename... Args>
+        ID emplaceCompId(Args&&... args);
+
+        // Creates a component for the entry just added to the component set
+        // If the constructor throws, the entry is removed before rethrowing, so the
+            // entity doesn't end up with a component that doesn't exist
+        template <typename T, typename... Args>
+        ID createComp(ComponentArray<T>& compArray, ID& compSetEntry, Args&&... args);
+
+        // Constructs a new value for a component, and moves it into place
+        template <typename T, typename... Args>
+        void reconstruct(T& comp, Args&&... args);
+
+        // Counts a change to a component, and calls a lifecycle signal of it,
+            // if its type has any listeners
+        void notify(BaseComponentArray& compArray, ID compId, ComponentSignal ComponentSignals::* signal);
+
         // Remove a component by type index
         void removeComp(const std::type_index& typeIdx);
 
+        // Returns true if the entity has all of the component types in the array
+        bool hasTypes(const TypeIndex* types, size_t count) const;
+
         // For ending recursion
         void assignFrom() {}
 
@@ -257,33 +324,132 @@ Entity& Entity::assign(Args&&... args)
     if (valid())
     {
         auto& compArray = core->components.get<T>();
-        auto& compSet = core->entities[id].compSet;
-        auto found = compSet.find(typeid(T));
-        if (found == compSet.end())
+        auto inserted = core->entities[id].compSet.try_emplace(typeid(T), invalidId);
+        if (inserted.second)
         {
             // Create new component and update component set
-            es::ID compId = compArray.create(args...);
-            compSet[typeid(T)] = compId;
-            compArray[compId].ownerId = id;
+            createComp(compArray, inserted.first->second, std::forward<Args>(args)...);
         }
         else
         {
             // Assign existing component
-            es::ID compId = found->second;
+            es::ID compId = inserted.first->second;
             auto& comp = compArray[compId];
-            comp = T(args...);
+            comp = T(std::forward<Args>(args)...);
             comp.ownerId = id;
+            notify(compArray, compId, &ComponentSignals::update);
         }
     }
     return *this;
 }
 
+template <typename T, typename... Args>
+T* Entity::emplace(Args&&... args)
+{
+    ID compId = emplaceCompId<T>(std::forward<Args>(args)...);
+    if (compId != invalidId)
+        return &core->components.get<T>()[compId];
+    return nullptr;
+}
+
+template <typename T, typename... Args>
+T* Entity::replace(Args&&... args)
+{
+    ID compId = getCompId<T>();
+    if (compId == invalidId)
+        return nullptr;
+    auto& compArray = core->components.get<T>();
+    reconstruct(compArray[compId], std::forward<Args>(args)...);
+    notify(compArray, compId, &ComponentSignals::update);
+    return &compArray[compId];
+}
+
+template <typename T, typename... Args>
+T* Entity::emplaceOrReplace(Args&&... args)
+{
+    if (!valid())
+        return nullptr;
+    auto& compArray = core->components.get<T>();
+    auto inserted = core->entities[id].compSet.try_emplace(typeid(T), invalidId);
+    if (inserted.second)
+        return &compArray[createComp(compArray, inserted.first->second, std::forward<Args>(args)...)];
+    ID compId = inserted.first->second;
+    reconstruct(compArray[compId], std::forward<Args>(args)...);
+    notify(compArray, compId, &ComponentSignals::update);
+    return &compArray[compId];
+}
+
+template <typename T, typename Func>
+bool Entity::patch(Func func)
+{
+    ID compId = getCompId<T>();
+    if (compId == invalidId)
+        return false;
+    auto& compArray = core->components.get<T>();
+    func(compArray[compId]);
+    notify(compArray, compId, &ComponentSignals::update);
+    return true;
+}
+
+template <typename T, typename... Args>
+ID Entity::emplaceCompId(Args&&... args)
+{
+    if (!valid())
+        return invalidId;
+    auto inserted = core->entities[id].compSet.try_emplace(typeid(T), invalidId);
+    if (inserted.second)
+        return createComp(core->components.get<T>(), inserted.first->second, std::forward<Args>(args)...);
+    return inserted.first->second;
+}
+
+template <typename T, typename... Args>
+ID Entity::createComp(ComponentArray<T>& compArray, ID& compSetEntry, Args&&... args)
+{
+    ID compId = invalidId;
+    try
+    {
+        compId = compArray.createFor(id, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        core->entities[id].compSet.erase(typeid(T));
+        throw;
+    }
+    compSetEntry = compId;
+    compArray[compId].ownerId = id;
+    notify(compArray, compId, &ComponentSignals::construct);
+    return compId;
+}
+
+template <typename T, typename... Args>
+void Entity::reconstruct(T& comp, Args&&... args)
+{
+    // The new value is constructed first, since the arguments can refer to the component
+    T value(std::forward<Args>(args)...);
+    comp = std::move(value);
+    comp.ownerId = id;
+}
+
+inline void Entity::notify(BaseComponentArray& compArray, ID compId, ComponentSignal ComponentSignals::* signal)
+{
+    compArray.markChanged();
+    auto signals = compArray.getSignals();
+    if (signals)
+        (signals->*signal)(*core, compArray[compId]);
+}
+
 template <typename T>
 Entity& Entity::operator<<(const T& comp)
 {
     return assignFrom<T>(comp);
 }
 
+template <typename T, typename>
+Entity& Entity::operator<<(T&& comp)
+{
+    return assign<T>(std::move(comp));
+}
+
 template <typename T>
 Handle<ComponentArray<T>, T> Entity::get()
 {
@@ -320,19 +486,15 @@ const Entity& Entity::operator>>(T& comp) const
 template <typename T>
 Handle<ComponentArray<T>, T> Entity::at()
 {
-    // TODO: Make this more efficient
-    if (!has<T>())
-        assign<T>();
-    return get<T>();
+    return {&core->components.get<T>(), emplaceCompId<T>()};
 }
 
 template <typename T>
 T& Entity::access()
 {
-    // TODO: Make this more efficient
-    if (!has<T>())
-        assign<T>();
-    return *getPtr<T>();
+    auto comp = emplace<T>();
+    assert(comp);
+    return *comp;
 }
 
 template <typename T>
@@ -13,14 +13,22 @@
 namespace es
 {
 
+class World;
+
 // Loads all prototypes from a config file (returns true if successful)
 bool loadPrototypes(const std::string& configFilename);
 
+// Loads all prototypes from a config file into a prototype bank
+// Use World::setPrototypes() to copy entities from the bank
+bool loadPrototypes(const std::string& configFilename, World& bank);
+
 /*
 Loads pre-configured entities with components from a ConfigFile.
 Entities can be made from these prototypes, using the name.
 Prototypes are part of the static World instance in es::World::prototypes.
     This means they only need to be loaded once.
+    They can also be loaded into any other world, which can be used as the
+        prototype bank of other worlds with World::setPrototypes().
 
 Inheritance:
     You can have an entity "inherit" from another entity, which means all of the
@@ -56,6 +64,7 @@ class EntityPrototypeLoader
 {
     public:
         EntityPrototypeLoader(const std::string& configFilename);
+        EntityPrototypeLoader(const std::string& configFilename, World& bank);
         bool load();
 
     private:
@@ -82,6 +91,7 @@ class EntityPrototypeLoader
         };
 
         cfg::File config;
+        World& bank;
         std::map<std::string, ParentInfo> entToComp;
 
         // Temporary for each entity
@@ -7,13 +7,16 @@
 // Includes all headers part of ES
 #include <es/component.h>
 #include <es/componentpool.h>
+#include <es/coroutine.h>
 #include <es/entity.h>
 #include <es/entityprototypeloader.h>
 #include <es/es.h>
 #include <es/events.h>
+#include <es/eventstream.h>
 #include <es/serialize.h>
 #include <es/systemcontainer.h>
 #include <es/system.h>
+#include <es/targetedchannel.h>
 #include <es/world.h>
 
 #endif
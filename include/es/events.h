@@ -8,23 +8,564 @@
 #include <typeindex>
 #include <unordered_map>
 #include <memory>
-#include <deque>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+#include <utility>
+#include <cassert>
+#include <algorithm>
+#include <initializer_list>
+#include <es/eventstream.h>
+#include <es/targetedchannel.h>
+#include <es/internal/timingwheel.h>
 
 namespace es
 {
 
+// What iterating over an event channel goes through
+enum class EventReading
+{
+    LastFrame, // The events sent during the last frame, so each event is seen once
+    Pending    // Every event that wasn't dropped or cleared yet (used by es::Events)
+};
+
 /*
-TODO:
-    Implement a better way of receiving events
-        That way you wouldn't need to clear them
-        Or, clearAll would only clear the events read
-    Add frame counter debugging feature.
-        When the frame # of the event != the current frame counter,
-            your events are being received too late!
+The events of a single type, stored in two contiguous buffers:
+    Current: Events sent during this frame
+    Previous: Events sent during the last frame
+When the bus moves to the next frame, the current events become the previous ones,
+    and the old previous events are dropped. This happens the next time the channel
+    is used, so moving to the next frame doesn't depend on the number of event types.
+Receiving:
+    Iterating over the channel goes through the previous events, so a reader that runs
+        once per frame sees each event exactly once, one frame late.
+    Channels of the global es::Events bus use EventReading::Pending instead, where
+        iterating goes through all of the events until they are cleared.
+    all() goes through the previous events, then the current ones. Since events stay for
+        two frames, this also sees events from systems that run later in the frame, but
+        the events sent earlier in this frame will be seen again next frame.
+Delayed events:
+    Events sent with sendAfter() wait in the channel until their timer expires (see TimingWheel),
+        then they are sent like any other event, at the start of that frame.
+Sending from worker threads:
+    Each worker sends to its own producer buffer with sendFrom(), without any locking.
+    The buffers are merged into the channel at the sync point (merge(), which
+        EventBus::nextFrame() calls), in the order of the producer indexes, so the
+        order of the events doesn't depend on how the threads were scheduled.
 */
+template <class T>
+class EventChannel: public BaseEventChannel
+{
+    public:
+
+        // Iterates through the previous events, then the current ones (see all())
+        // Note: Uses positions, so sending events while iterating is safe
+        class iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = T*;
+                using reference = T&;
+
+                iterator(EventChannel* channel, size_t pos): channel(channel), pos(pos) {}
+
+                T& operator*() const { return channel->at(pos); }
+                T* operator->() const { return &channel->at(pos); }
+                iterator& operator++() { ++pos; return *this; }
+                iterator operator++(int) { auto tmp = *this; ++pos; return tmp; }
+                bool operator==(const iterator& other) const { return pos == other.pos; }
+                bool operator!=(const iterator& other) const { return pos != other.pos; }
+
+                // Returns the frame the event was sent in
+                uint64_t frame() const { return channel->frameAt(pos); }
+
+            private:
+                EventChannel* channel;
+                size_t pos;
+        };
+
+        explicit EventChannel(const uint64_t& busFrame, TimingWheel* timers = nullptr,
+            EventReading reading = EventReading::LastFrame):
+            frame(busFrame), busFrame(&busFrame), reading(reading), timers(timers), delayed(*this) {}
+
+        // Sends an event
+        void send(const T& event)
+        {
+            update();
+            current.push_back(event);
+        }
+
+        // Sends an event (forwards arguments)
+        template <class... Args>
+        void send(Args&&... args)
+        {
+            update();
+            current.emplace_back(std::forward<Args>(args)...);
+        }
+
+        // Sends an event after a number of frames (forwards arguments)
+        // Returns the ID of the timer, which can be cancelled (see EventBus::cancelTimer())
+        // With 0 frames, the event is sent right away, and invalidId is returned
+        // Note: Only works with channels from an EventBus
+        template <class... Args>
+        ID sendAfter(uint64_t frames, Args&&... args)
+        {
+            if (frames == 0)
+            {
+                send(std::forward<Args>(args)...);
+                return invalidId;
+            }
+            assert(timers);
+            return timers->schedule(frames, delayed, delayed.events.create(std::forward<Args>(args)...));
+        }
+
+        // Returns the number of events waiting to be sent by sendAfter()
+        size_t getDelayed() const
+        {
+            return delayed.events.size();
+        }
+
+        // Sets the number of producer buffers, for sending from worker threads
+        // Note: Only call this while no workers are sending
+        void setProducers(size_t count)
+        {
+            producers.resize(count);
+        }
+
+        // Returns the number of producer buffers
+        size_t getProducers() const
+        {
+            return producers.size();
+        }
+
+        // Sends an event from a worker thread into its own buffer (forwards arguments)
+        // Different producers can send at the same time, but each producer index
+            // must only be used by one thread at a time
+        // The event is added to the channel at the next merge()
+        template <class... Args>
+        void sendFrom(size_t producer, Args&&... args)
+        {
+            assert(producer < producers.size());
+            producers[producer].events.emplace_back(std::forward<Args>(args)...);
+        }
+
+        // Moves the events from the producer buffers into this frame's events
+        // Note: Only call this while no workers are sending
+        void merge()
+        {
+            update();
+            for (auto& producer: producers)
+            {
+                current.insert(current.end(), std::make_move_iterator(producer.events.begin()),
+                    std::make_move_iterator(producer.events.end()));
+                producer.events.clear();
+            }
+        }
+
+        // Returns the events sent during this frame
+        const std::vector<T>& getCurrent()
+        {
+            update();
+            return current;
+        }
+
+        // Returns the events sent during the last frame
+        const std::vector<T>& getPrevious()
+        {
+            update();
+            return previous;
+        }
+
+        // Returns the frame the current events are being sent in
+        uint64_t getFrame() const
+        {
+            return *busFrame;
+        }
+
+        // Returns the number of events from this frame and the last frame
+        size_t size() const
+        {
+            if (frame == *busFrame)
+                return previous.size() + current.size();
+            if (frame + 1 == *busFrame)
+                return current.size();
+            return 0;
+        }
+
+        bool empty() const
+        {
+            return (size() == 0);
+        }
+
+        // Removes the events from this frame and the last frame
+        void clear()
+        {
+            previous.clear();
+            current.clear();
+            frame = *busFrame;
+        }
+
+        // The events from the last frame, then the ones from this frame
+        class Range
+        {
+            public:
+                Range(iterator first, iterator last): first(first), last(last) {}
+
+                iterator begin() const { return first; }
+                iterator end() const { return last; }
+
+            private:
+                iterator first;
+                iterator last;
+        };
+
+        // Iterates through the events sent during the last frame
+        // Each event is visited by exactly one frame, so a reader that runs every frame
+            // sees each event once
+        // With EventReading::Pending, this is the same as all()
+        iterator begin()
+        {
+            update();
+            return {this, 0};
+        }
+
+        iterator end()
+        {
+            update();
+            return {this, previous.size() + (reading == EventReading::Pending ? current.size() : 0)};
+        }
+
+        // Returns the events from the last frame and this frame
+        // Note: Reading this every frame sees each event twice
+        Range all()
+        {
+            update();
+            return {{this, 0}, {this, previous.size() + current.size()}};
+        }
+
+    private:
+
+        // Swaps the buffers if the bus moved to another frame
+        // Note: The vectors keep their memory, so a steady number of events doesn't allocate
+        void update()
+        {
+            if (frame != *busFrame)
+            {
+                if (frame + 1 == *busFrame)
+                    std::swap(previous, current);
+                else
+                    previous.clear();
+                current.clear();
+                frame = *busFrame;
+            }
+        }
+
+        T& at(size_t pos)
+        {
+            return (pos < previous.size() ? previous[pos] : current[pos - previous.size()]);
+        }
+
+        uint64_t frameAt(size_t pos) const
+        {
+            return (pos < previous.size() ? frame - 1 : frame);
+        }
+
+        std::vector<T> previous;
+        std::vector<T> current;
+
+        // Each producer buffer is on its own cache line, so workers don't slow each other down
+        struct alignas(64) ProducerBuffer
+        {
+            std::vector<T> events;
+        };
+
+        std::vector<ProducerBuffer> producers;
+
+        // The frame of the current events
+        uint64_t frame;
+
+        const uint64_t* busFrame;
+
+        EventReading reading;
+
+        // Events sent with sendAfter(), until their timers expire
+        class DelayedEvents: public TimerTarget
+        {
+            public:
+                explicit DelayedEvents(EventChannel& channel): channel(channel) {}
+
+                void expire(ID id)
+                {
+                    channel.send(std::move(events[id]));
+                    events.erase(id);
+                }
+
+                void cancel(ID id)
+                {
+                    events.erase(id);
+                }
+
+                PackedArray<T> events;
+
+            private:
+                EventChannel& channel;
+        };
+
+        TimingWheel* timers;
+        DelayedEvents delayed;
+};
+
+/*
+A set of event channels, one for each event type.
+Each World has its own event bus, so worlds on different threads don't share events.
+Events are kept for the frame they were sent in and the next frame, then they are
+    dropped automatically (see EventChannel). World::nextFrame() moves the bus of
+    a world to the next frame.
+To send events:
+    world.events().send(YourOwnEvent("Testing"));
+To receive events:
+    for (auto& event: world.events().get<YourOwnEvent>())
+        doSomethingWithEvent(event);
+Looking up a channel costs a hash lookup, so a system can keep the channel instead:
+    auto& channel = world.events().channel<YourOwnEvent>();
+    channel.send("Testing");
+Events can also be sent after a number of frames, which costs the same no matter how many are waiting:
+    auto timer = world.events().sendAfter(180, Explode(position));
+    world.events().cancelTimer(timer);
+Events that several systems read can use a stream instead, where each reader has its own cursor:
+    auto reader = world.events().stream<YourOwnEvent>().reader();
+    for (auto& event: reader.read())
+        doSomethingWithEvent(event);
+Events sent to a single entity can be looked up by the entity, starting the next frame:
+    world.events().sendTo(ent.getId(), Damage(5));
+    for (auto& damage: world.events().targeted<Damage>().get(ent.getId()))
+        takeDamage(damage);
+*/
+class EventBus
+{
+    public:
+
+        // The reading mode is used by all of the channels (see EventReading)
+        explicit EventBus(EventReading reading = EventReading::LastFrame): reading(reading) {}
+
+        // Channels point to the frame counter of the bus, so it can't be copied
+        EventBus(const EventBus&) = delete;
+        EventBus& operator=(const EventBus&) = delete;
+
+        // Returns the channel of an event type (it is created if needed)
+        // The reference stays valid as long as the bus exists
+        template <class T>
+        EventChannel<T>& channel()
+        {
+            // Get the pointer to the event channel
+            auto& specificEvents = eventChannels[typeid(T)];
+
+            // Create a new channel if it doesn't exist for this type
+            if (!specificEvents)
+                specificEvents = std::make_unique<EventChannel<T>>(frame, &timers, reading);
+
+            // Return the specific type of event channel (casted from the base class pointer)
+            return *(static_cast<EventChannel<T>*>(specificEvents.get()));
+        }
+
+        // Lets a number of worker threads send events of a type at the same time
+        // Returns the channel, which workers can send to with sendFrom()
+        // Note: Workers can't look up channels themselves, so get the channel before
+            // starting the workers, and don't call this while they are sending
+        template <class T>
+        EventChannel<T>& setProducers(size_t count)
+        {
+            auto& eventChannel = channel<T>();
+            eventChannel.setProducers(count);
+            if (std::find(producerChannels.begin(), producerChannels.end(), &eventChannel) == producerChannels.end())
+                producerChannels.push_back(&eventChannel);
+            return eventChannel;
+        }
+
+        // Merges the events sent from worker threads into their channels
+        // Only the channels that have producers are visited
+        void sync()
+        {
+            for (auto producerChannel: producerChannels)
+                producerChannel->merge();
+        }
+
+        // Returns the stream of an event type (it is created if needed)
+        // Streams are separate from channels, and don't depend on frames (see EventStream)
+        // The reference stays valid as long as the bus exists
+        template <class T>
+        EventStream<T>& stream()
+        {
+            auto& specificEvents = eventStreams[typeid(T)];
+            if (!specificEvents)
+                specificEvents = std::make_unique<EventStream<T>>();
+            return *(static_cast<EventStream<T>*>(specificEvents.get()));
+        }
+
+        // Returns the targeted channel of an event type (it is created if needed)
+        // Targeted channels are separate from channels, see TargetedChannel
+        // The reference stays valid as long as the bus exists
+        template <class T>
+        TargetedChannel<T>& targeted()
+        {
+            auto& specificEvents = targetedChannels[typeid(T)];
+            if (!specificEvents)
+                specificEvents = std::make_unique<TargetedChannel<T>>(frame);
+            return *(static_cast<TargetedChannel<T>*>(specificEvents.get()));
+        }
+
+        // Same as channel()
+        template <class T>
+        EventChannel<T>& get()
+        {
+            return channel<T>();
+        }
+
+        // Sends an event
+        // bus.send(Type(anything));
+        template <class T>
+        void send(const T& event)
+        {
+            channel<T>().send(event);
+        }
+
+        // Sends an event (forwards arguments)
+        // bus.send<Type>(anything);
+        template <class T, class... Args>
+        void send(Args&&... args)
+        {
+            channel<T>().send(std::forward<Args>(args)...);
+        }
+
+        // Sends an event to an entity
+        // bus.sendTo(id, Type(anything));
+        template <class T>
+        void sendTo(ID target, const T& event)
+        {
+            targeted<T>().send(target, event);
+        }
+
+        // Sends an event to an entity (forwards arguments)
+        // bus.sendTo<Type>(id, anything);
+        template <class T, class... Args>
+        void sendTo(ID target, Args&&... args)
+        {
+            targeted<T>().send(target, std::forward<Args>(args)...);
+        }
+
+        // Sends an event after a number of frames
+        // Returns the ID of the timer, or invalidId if the event was sent right away
+        // bus.sendAfter(frames, Type(anything));
+        template <class T>
+        ID sendAfter(uint64_t frames, const T& event)
+        {
+            return channel<T>().sendAfter(frames, event);
+        }
+
+        // Sends an event after a number of frames (forwards arguments)
+        // bus.sendAfter<Type>(frames, anything);
+        template <class T, class... Args>
+        ID sendAfter(uint64_t frames, Args&&... args)
+        {
+            return channel<T>().sendAfter(frames, std::forward<Args>(args)...);
+        }
+
+        // Cancels a timer, such as a delayed event
+        // Returns false if the timer already expired or was cancelled
+        bool cancelTimer(ID timerId)
+        {
+            return timers.cancel(timerId);
+        }
+
+        // Returns the timers, which expire as the frames move forward
+        TimingWheel& getTimers()
+        {
+            return timers;
+        }
+
+        // Returns true if there are any events of a certain type
+        template <class T>
+        bool exists()
+        {
+            return !channel<T>().empty();
+        }
+
+        // Removes events of the specified type
+        template <class T>
+        void clear()
+        {
+            channel<T>().clear();
+        }
+
+        // Clears events of all types (in all channels and streams)
+        // Note: Delayed events that weren't sent yet are kept
+        void clearAll()
+        {
+            for (auto table: {&eventChannels, &eventStreams, &targetedChannels})
+            {
+                for (auto& eventChannel: *table)
+                    eventChannel.second->clear();
+            }
+        }
+
+        // Returns the total number of events (in all channels and streams)
+        size_t getTotal() const
+        {
+            size_t total = 0;
+            for (auto table: {&eventChannels, &eventStreams, &targetedChannels})
+            {
+                for (auto& eventChannel: *table)
+                    total += eventChannel.second->size();
+            }
+            return total;
+        }
+
+        // Moves to the next frame, which drops the events from the last frame
+        // The events from worker threads are merged first (see sync())
+        // Then the timers move forward a tick, so delayed events are sent at the start of the new frame
+        // Other than that, this only increments the frame counter, the channels update when they are used
+        void nextFrame()
+        {
+            sync();
+            ++frame;
+            timers.advance();
+        }
+
+        // Returns the current frame number
+        uint64_t getFrame() const
+        {
+            return frame;
+        }
+
+    private:
+
+        // Table of types to event channels
+        using EventChannelTable = std::unordered_map<std::type_index, std::unique_ptr<BaseEventChannel>>;
+        EventChannelTable eventChannels;
+        EventChannelTable eventStreams;
+        EventChannelTable targetedChannels;
+
+        // Channels that can be sent to from worker threads
+        std::vector<BaseEventChannel*> producerChannels;
+
+        uint64_t frame {0};
+
+        EventReading reading;
+
+        // Delayed events and other timers, one tick per frame
+        TimingWheel timers;
+};
 
 /*
 This class can be used to send and receive global events of any type.
+All threads share the same event bus (see getBus()), which is not thread safe.
+    Code that runs worlds on different threads should use World::events() instead.
+The frame is only moved forward by calling nextFrame(), so without calling it,
+    events are kept until they are cleared.
+Iterating over a channel goes through all of the events that weren't dropped or cleared
+    yet, including the ones sent during this frame (see EventReading::Pending).
 To send events:
     es::Events::send(YourOwnEvent("Testing"));
 To receive events:
@@ -37,14 +578,18 @@ class Events
 {
     public:
 
+        // Returns the channel of the specified type
         template <class T>
-        using EventQueueType = std::deque<T>;
+        static EventChannel<T>& get()
+        {
+            return getBus().channel<T>();
+        }
 
-        // Returns a reference to the queue of the specified type
+        // Returns the stream of the specified type
         template <class T>
-        static EventQueueType<T>& get()
+        static EventStream<T>& stream()
         {
-            return getQueue<T>().events;
+            return getBus().stream<T>();
         }
 
         // Sends a global event
@@ -52,7 +597,7 @@ class Events
         template <class T>
         static void send(const T& event)
         {
-            get<T>().push_back(event);
+            getBus().send(event);
         }
 
         // Sends a global event (forwards arguments)
@@ -60,86 +605,91 @@ class Events
         template <class T, class... Args>
         static void send(Args&&... args)
         {
-            get<T>().emplace_back(std::forward<Args>(args)...);
+            getBus().send<T>(std::forward<Args>(args)...);
         }
 
-        // Returns true if there are any events of a certain type
+        // Returns the targeted channel of the specified type
         template <class T>
-        static bool exists()
+        static TargetedChannel<T>& targeted()
         {
-            return !get<T>().empty();
+            return getBus().targeted<T>();
         }
 
-        // Removes events of the specified type
+        // Sends a global event to an entity
+        // es::Events::sendTo(id, Type(anything));
         template <class T>
-        static void clear()
+        static void sendTo(ID target, const T& event)
         {
-            get<T>().clear();
+            getBus().sendTo(target, event);
         }
 
-        // Clears messages of all types
-        static void clearAll()
+        // Sends a global event to an entity (forwards arguments)
+        // es::Events::sendTo<Type>(id, anything);
+        template <class T, class... Args>
+        static void sendTo(ID target, Args&&... args)
         {
-            for (auto& eventQueue: getEventQueueTable())
-                eventQueue.second->clear();
+            getBus().sendTo<T>(target, std::forward<Args>(args)...);
         }
 
-        // Returns the total number of events
-        static size_t getTotal()
+        // Sends a global event after a number of frames
+        // es::Events::sendAfter(frames, Type(anything));
+        template <class T>
+        static ID sendAfter(uint64_t frames, const T& event)
         {
-            size_t total = 0;
-            for (auto& eventQueue: getEventQueueTable())
-                total += eventQueue.second->size();
-            return total;
+            return getBus().sendAfter(frames, event);
         }
 
-    private:
-
-        // The following classes are needed for clearAll to work.
-        struct BaseEventQueue
+        // Sends a global event after a number of frames (forwards arguments)
+        // es::Events::sendAfter<Type>(frames, anything);
+        template <class T, class... Args>
+        static ID sendAfter(uint64_t frames, Args&&... args)
         {
-            virtual ~BaseEventQueue() {}
-            virtual void clear() = 0;
-            virtual size_t size() const = 0;
-        };
+            return getBus().sendAfter<T>(frames, std::forward<Args>(args)...);
+        }
 
-        template <class EventType>
-        struct EventQueue: public BaseEventQueue
+        // Cancels a delayed event
+        static bool cancelTimer(ID timerId)
         {
-            EventQueueType<EventType> events;
-
-            void clear()
-            {
-                events.clear();
-            }
+            return getBus().cancelTimer(timerId);
+        }
 
-            size_t size() const
-            {
-                return events.size();
-            }
-        };
+        // Returns true if there are any events of a certain type
+        template <class T>
+        static bool exists()
+        {
+            return getBus().exists<T>();
+        }
 
-        // Returns instance of correct event queue class
+        // Removes events of the specified type
         template <class T>
-        static EventQueue<T>& getQueue()
+        static void clear()
         {
-            // Get the pointer to the event queue
-            auto& specificEvents = getEventQueueTable()[typeid(T)];
+            getBus().clear<T>();
+        }
 
-            // Create a new queue if it doesn't exist for this type
-            if (!specificEvents)
-                specificEvents = std::make_unique<EventQueue<T>>();
+        // Clears events of all types
+        static void clearAll()
+        {
+            getBus().clearAll();
+        }
 
-            // Return the specific type of event queue (casted from the base class pointer)
-            return *(static_cast<EventQueue<T>*>(specificEvents.get()));
+        // Returns the total number of events
+        static size_t getTotal()
+        {
+            return getBus().getTotal();
+        }
+
+        // Moves to the next frame, which drops the events from the last frame
+        static void nextFrame()
+        {
+            getBus().nextFrame();
         }
 
-        // Table of types to event queues
-        using EventQueueTable = std::unordered_map<std::type_index, std::unique_ptr<BaseEventQueue>>;
-        static EventQueueTable& getEventQueueTable()
+        // Returns the global event bus
+        static EventBus& getBus()
         {
-            static EventQueueTable eventQueues;
-            return eventQueues;
+            static EventBus bus(EventReading::Pending);
+            return bus;
         }
 };
 
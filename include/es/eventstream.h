@@ -0,0 +1,302 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_EVENTSTREAM_H
+#define ES_EVENTSTREAM_H
+
+#include <vector>
+#include <optional>
+#include <iterator>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+namespace es
+{
+
+// Needed for clearAll and getTotal to work with any event type
+class BaseEventChannel
+{
+    public:
+        virtual ~BaseEventChannel() {}
+        virtual void clear() = 0;
+        virtual size_t size() const = 0;
+
+        // Moves events sent from worker threads into the main buffer
+        virtual void merge() = 0;
+};
+
+/*
+Events of a single type in a ring buffer, which any number of readers can read from.
+    Each reader has its own cursor, so every reader sees every event exactly once,
+        without copying the events, and without anything needing to be cleared.
+    Events are written once, and destroyed after every reader has moved past them.
+        Their slots are then reused, so the buffer only grows when a reader falls behind.
+    Readers only see the events sent after they were created.
+Example:
+    auto reader = stream.reader();
+    stream.send(YourOwnEvent("Testing"));
+    for (auto& event: reader.read())
+        doSomethingWithEvent(event);
+Note: The stream must outlive its readers.
+*/
+template <class T>
+class EventStream: public BaseEventChannel
+{
+    public:
+
+        // Iterates through events by their sequence number
+        class iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = T*;
+                using reference = T&;
+
+                iterator(EventStream* stream, uint64_t seq): stream(stream), seq(seq) {}
+
+                T& operator*() const { return stream->at(seq); }
+                T* operator->() const { return &stream->at(seq); }
+                iterator& operator++() { ++seq; return *this; }
+                iterator operator++(int) { auto tmp = *this; ++seq; return tmp; }
+                bool operator==(const iterator& other) const { return seq == other.seq; }
+                bool operator!=(const iterator& other) const { return seq != other.seq; }
+
+            private:
+                EventStream* stream;
+                uint64_t seq;
+        };
+
+        // A range of events returned from a read
+        class Range
+        {
+            public:
+                Range(EventStream* stream, uint64_t first, uint64_t last):
+                    stream(stream), first(first), last(last) {}
+
+                iterator begin() const { return {stream, first}; }
+                iterator end() const { return {stream, last}; }
+                size_t size() const { return last - first; }
+                bool empty() const { return first == last; }
+
+            private:
+                EventStream* stream;
+                uint64_t first;
+                uint64_t last;
+        };
+
+        // Reads events from a stream with its own cursor
+        class Reader
+        {
+            public:
+                Reader() {}
+
+                Reader(Reader&& other): stream(other.stream), slot(other.slot)
+                {
+                    other.stream = nullptr;
+                }
+
+                Reader& operator=(Reader&& other)
+                {
+                    if (this != &other)
+                    {
+                        release();
+                        stream = other.stream;
+                        slot = other.slot;
+                        other.stream = nullptr;
+                    }
+                    return *this;
+                }
+
+                Reader(const Reader&) = delete;
+                Reader& operator=(const Reader&) = delete;
+
+                ~Reader()
+                {
+                    release();
+                }
+
+                // Returns the events sent since the last read
+                // The events stay valid until the next read, even if more events are sent
+                Range read()
+                {
+                    if (!stream)
+                        return {nullptr, 0, 0};
+                    auto& cursor = stream->cursors[slot];
+                    cursor.first = cursor.last;
+                    cursor.last = stream->tail;
+                    return {stream, cursor.first, cursor.last};
+                }
+
+                // Returns the number of events that haven't been read yet
+                size_t unread() const
+                {
+                    return (stream ? stream->tail - stream->cursors[slot].last : 0);
+                }
+
+                bool valid() const
+                {
+                    return (stream != nullptr);
+                }
+
+            private:
+
+                friend class EventStream;
+
+                Reader(EventStream* stream, size_t slot): stream(stream), slot(slot) {}
+
+                // Lets the stream reclaim the events this reader was keeping
+                void release()
+                {
+                    if (stream)
+                        stream->cursors[slot].used = false;
+                    stream = nullptr;
+                }
+
+                EventStream* stream {nullptr};
+                size_t slot {0};
+        };
+
+        explicit EventStream(size_t initialCapacity = 64)
+        {
+            // The capacity is a power of 2, so positions can be masked
+            size_t capacity = 1;
+            while (capacity < initialCapacity)
+                capacity *= 2;
+            buffer.resize(capacity);
+        }
+
+        // Readers point to the stream, so it can't be copied
+        EventStream(const EventStream&) = delete;
+        EventStream& operator=(const EventStream&) = delete;
+
+        // Creates a reader, which will see all events sent after this
+        Reader reader()
+        {
+            size_t slot = 0;
+            while (slot < cursors.size() && cursors[slot].used)
+                ++slot;
+            if (slot == cursors.size())
+                cursors.emplace_back();
+            cursors[slot] = Cursor{tail, tail, true};
+            return {this, slot};
+        }
+
+        // Sends an event
+        void send(const T& event)
+        {
+            prepareSlot();
+            buffer[tail & mask()].emplace(event);
+            ++tail;
+        }
+
+        // Sends an event (forwards arguments)
+        template <class... Args>
+        void send(Args&&... args)
+        {
+            prepareSlot();
+            buffer[tail & mask()].emplace(std::forward<Args>(args)...);
+            ++tail;
+        }
+
+        // Returns the number of events that haven't been read by every reader yet
+        size_t size() const
+        {
+            return tail - oldestCursor();
+        }
+
+        // Returns the number of events that fit before the buffer grows
+        size_t capacity() const
+        {
+            return buffer.size();
+        }
+
+        // Returns the number of readers
+        size_t readers() const
+        {
+            return std::count_if(cursors.begin(), cursors.end(), [](const Cursor& cursor) { return cursor.used; });
+        }
+
+        // Removes all events, and moves every reader past them
+        void clear()
+        {
+            for (auto& cursor: cursors)
+                cursor.first = cursor.last = tail;
+            reclaim();
+        }
+
+        // Streams are only sent to from one thread, so there is nothing to merge
+        void merge() {}
+
+    private:
+
+        // Events from first up to last were returned by the last read
+        // Events before first have been read, and can be reclaimed
+        struct Cursor
+        {
+            uint64_t first;
+            uint64_t last;
+            bool used;
+        };
+
+        size_t mask() const
+        {
+            return buffer.size() - 1;
+        }
+
+        T& at(uint64_t seq)
+        {
+            return *buffer[seq & mask()];
+        }
+
+        // Returns the sequence number of the oldest event any reader still needs
+        uint64_t oldestCursor() const
+        {
+            uint64_t oldest = tail;
+            for (auto& cursor: cursors)
+            {
+                if (cursor.used)
+                    oldest = std::min(oldest, cursor.first);
+            }
+            return oldest;
+        }
+
+        // Destroys the events every reader has moved past
+        void reclaim()
+        {
+            uint64_t oldest = oldestCursor();
+            for (; head < oldest; ++head)
+                buffer[head & mask()].reset();
+        }
+
+        // Makes room for one more event, growing only if a reader is behind
+        void prepareSlot()
+        {
+            if (tail - head < buffer.size())
+                return;
+            reclaim();
+            if (tail - head < buffer.size())
+                return;
+
+            // Double the buffer, and move the events to their new positions
+            std::vector<std::optional<T>> newBuffer(buffer.size() * 2);
+            size_t newMask = newBuffer.size() - 1;
+            for (uint64_t seq = head; seq < tail; ++seq)
+                newBuffer[seq & newMask].emplace(std::move(*buffer[seq & mask()]));
+            buffer = std::move(newBuffer);
+        }
+
+        std::vector<std::optional<T>> buffer;
+
+        // Sequence numbers of the oldest stored event, and the next event
+        uint64_t head {0};
+        uint64_t tail {0};
+
+        std::vector<Cursor> cursors;
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_CHUNKEDARRAY_H
+#define ES_CHUNKEDARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <iterator>
+
+namespace es
+{
+
+/*
+A vector-like container that stores its elements in fixed-size chunks.
+    Growing only allocates a new chunk, so existing elements are never moved
+        and pointers to them stay valid until they are erased.
+    Elements are still packed: every chunk is full except for the last one.
+    Chunks are kept allocated after shrinking, so they can be reused.
+    Chunks are allocated from a memory resource (the default resource unless one is given).
+*/
+template <class T, size_t ChunkSize>
+class ChunkedArray
+{
+    static_assert(ChunkSize && !(ChunkSize & (ChunkSize - 1)), "ChunkSize must be a power of two.");
+
+    public:
+
+        using value_type = T;
+
+        template <class Array, class Elem>
+        class Iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = Elem*;
+                using reference = Elem&;
+
+                Iterator(Array* array = nullptr, size_t pos = 0): array(array), pos(pos) {}
+
+                Elem& operator*() const { return (*array)[pos]; }
+                Elem* operator->() const { return &(*array)[pos]; }
+                Iterator& operator++() { ++pos; return *this; }
+                Iterator operator++(int) { auto tmp = *this; ++pos; return tmp; }
+                bool operator==(const Iterator& other) const { return pos == other.pos; }
+                bool operator!=(const Iterator& other) const { return pos != other.pos; }
+
+            private:
+                Array* array;
+                size_t pos;
+        };
+
+        using iterator = Iterator<ChunkedArray, T>;
+        using const_iterator = Iterator<const ChunkedArray, const T>;
+
+        ChunkedArray() {}
+
+        explicit ChunkedArray(std::pmr::memory_resource* resource):
+            chunks(resource),
+            resource(resource)
+        {
+        }
+
+        // Like the standard containers, copies use the default memory resource
+        ChunkedArray(const ChunkedArray& other)
+        {
+            reserve(other.count);
+            for (size_t i = 0; i < other.count; ++i)
+                emplace_back(other[i]);
+        }
+
+        ChunkedArray(ChunkedArray&& other):
+            chunks(std::move(other.chunks)),
+            count(other.count),
+            resource(other.resource)
+        {
+            other.count = 0;
+        }
+
+        ChunkedArray& operator=(const ChunkedArray& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other.count);
+                for (size_t i = 0; i < other.count; ++i)
+                    emplace_back(other[i]);
+            }
+            return *this;
+        }
+
+        // Chunks can only be taken from arrays using the same memory resource
+        ChunkedArray& operator=(ChunkedArray&& other)
+        {
+            if (this != &other)
+            {
+                if (resource->is_equal(*other.resource))
+                {
+                    freeChunks();
+                    chunks = std::move(other.chunks);
+                    count = other.count;
+                    other.chunks.clear();
+                    other.count = 0;
+                }
+                else
+                {
+                    clear();
+                    reserve(other.count);
+                    for (size_t i = 0; i < other.count; ++i)
+                        emplace_back(std::move(other[i]));
+                    other.clear();
+                }
+            }
+            return *this;
+        }
+
+        ~ChunkedArray()
+        {
+            freeChunks();
+        }
+
+        // Constructs a new element at the end
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (count == chunks.size() * ChunkSize)
+                chunks.push_back(allocateChunk());
+            T* ptr = new (address(count)) T(std::forward<Args>(args)...);
+            ++count;
+            return *ptr;
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        // Destroys the last element (the chunk stays allocated)
+        void pop_back()
+        {
+            --count;
+            address(count)->~T();
+        }
+
+        T& back() { return operator[](count - 1); }
+        const T& back() const { return operator[](count - 1); }
+
+        T& operator[] (size_t pos)
+        {
+            return *address(pos);
+        }
+
+        const T& operator[] (size_t pos) const
+        {
+            return *address(pos);
+        }
+
+        // Destroys all elements (the chunks stay allocated)
+        void clear()
+        {
+            while (count)
+                pop_back();
+        }
+
+        // Allocates enough chunks to hold the specified number of elements
+        void reserve(size_t capacity)
+        {
+            size_t chunksNeeded = (capacity + ChunkSize - 1) / ChunkSize;
+            chunks.reserve(chunksNeeded);
+            while (chunks.size() < chunksNeeded)
+                chunks.push_back(allocateChunk());
+        }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        std::pmr::polymorphic_allocator<T> get_allocator() const
+        {
+            return resource;
+        }
+
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, count}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, count}; }
+        const_iterator cbegin() const { return {this, 0}; }
+        const_iterator cend() const { return {this, count}; }
+
+        // Returns the number of chunks that contain elements
+        size_t chunkCount() const
+        {
+            return (count + ChunkSize - 1) / ChunkSize;
+        }
+
+        // Returns a pointer to the first element of a chunk
+        T* chunkData(size_t chunk)
+        {
+            return address(chunk * ChunkSize);
+        }
+
+        // Returns the number of elements in a chunk
+        size_t chunkSize(size_t chunk) const
+        {
+            size_t start = chunk * ChunkSize;
+            return (count - start < ChunkSize ? count - start : ChunkSize);
+        }
+
+    private:
+
+        T* allocateChunk()
+        {
+            return static_cast<T*>(resource->allocate(sizeof(T) * ChunkSize, alignof(T)));
+        }
+
+        // Destroys all elements, and frees all chunks
+        void freeChunks()
+        {
+            clear();
+            for (auto chunk: chunks)
+                resource->deallocate(chunk, sizeof(T) * ChunkSize, alignof(T));
+            chunks.clear();
+        }
+
+        T* address(size_t pos) const
+        {
+            return chunks[pos / ChunkSize] + (pos & (ChunkSize - 1));
+        }
+
+        std::pmr::vector<T*> chunks;
+        size_t count {0};
+        std::pmr::memory_resource* resource {std::pmr::get_default_resource()};
+};
+
+}
+
+#endif
@@ -6,23 +6,145 @@
 
 #include <es/component.h>
 #include <es/internal/packedarray.h>
+#include <es/internal/densearray.h>
+#include <es/internal/hasharray.h>
 #include <es/internal/id.h>
+#include <es/internal/signals.h>
 #include <memory>
+#include <typeindex>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+#include <utility>
 
 namespace es
 {
 
-// An interface for using a PackedArray of any component type
+template <class... Args>
+struct MakeVoid
+{
+    using type = void;
+};
+
+// Selects the PackedArray storage policy of a component type
+// Components can override the default with a member type:
+    // using Storage = es::ChunkedStorage<>;
+template <class T, class = void>
+struct ComponentStorage
+{
+    using type = VectorStorage;
+};
+
+template <class T>
+struct ComponentStorage<T, typename MakeVoid<typename T::Storage>::type>
+{
+    using type = typename T::Storage;
+};
+
+// Selects the PackedArray index policy of a component type
+// Components can override the default with a member type:
+    // using Index = es::PagedIndex<>;
+template <class T, class = void>
+struct ComponentIndex
+{
+    using type = DenseIndex<typename ComponentStorage<T>::type>;
+};
+
+template <class T>
+struct ComponentIndex<T, typename MakeVoid<typename T::Index>::type>
+{
+    using type = typename T::Index;
+};
+
+/*
+Component types don't need to be copyable, move-only types are supported.
+    Copying a move-only component (such as cloning an entity) skips it instead.
+    Note: The copy constructor must be deleted (or not declared) for the type to be
+        detected as move-only, a std::vector<std::unique_ptr<...>> member isn't enough.
+
+Layout policies for component arrays.
+Each one is a good fit for a different number of entities having the component:
+    SparseLayout: Packed components with their own IDs (default)
+        Good for most components, memory depends on the peak number of components
+    DenseLayout: Components stored at the index of their entity's ID
+        No indirection, but memory depends on the highest entity index,
+        so this is for components that almost every entity has
+    HashLayout: Packed components, found by their entity's ID with a hash table
+        Memory only depends on the current number of components,
+        so this is for components that very few entities have
+Components can override the default with a member type:
+    using Layout = es::DenseLayout;
+Note: Dense and hash layouts use the owner entity's ID as the component ID,
+    and don't support sorting or optimizeLayout() (their order is fixed).
+*/
+struct SparseLayout
+{
+    template <class T>
+    using Array = PackedArray<T, typename ComponentStorage<T>::type, typename ComponentIndex<T>::type>;
+
+    static const bool ownerKeyed = false;
+};
+
+struct DenseLayout
+{
+    template <class T>
+    using Array = DenseArray<T>;
+
+    static const bool ownerKeyed = true;
+};
+
+struct HashLayout
+{
+    template <class T>
+    using Array = HashArray<T>;
+
+    static const bool ownerKeyed = true;
+};
+
+// Selects the layout policy of a component type
+template <class T, class = void>
+struct ComponentLayout
+{
+    using type = SparseLayout;
+};
+
+template <class T>
+struct ComponentLayout<T, typename MakeVoid<typename T::Layout>::type>
+{
+    using type = typename T::Layout;
+};
+
+// An interface for using a component array of any component type
 class BaseComponentArray
 {
     public:
         BaseComponentArray() {}
         virtual ~BaseComponentArray() {}
 
-        virtual std::unique_ptr<BaseComponentArray> clone() const = 0;
-        virtual ID copyFrom(const BaseComponentArray& baseSrcArray, ID id) = 0;
+        // Copies the array, allocating the new one's components from a memory resource
+        // Arrays of move-only components are not copied, the new array is empty, and a
+            // warning is printed if any components were left out
+        virtual std::unique_ptr<BaseComponentArray> clone(std::pmr::memory_resource* resource) const = 0;
 
-        virtual ID create() = 0;
+        // Copies a component from another array of the same type, and returns its new ID
+        // Returns invalidId if the component type isn't copyable
+        virtual ID copyFrom(const BaseComponentArray& baseSrcArray, ID id, ID ownerId) = 0;
+
+        // Returns true if the component type is copy constructible
+        virtual bool isCopyable() const = 0;
+
+        // Moves a component out of another array of the same type, and returns its new ID
+        // The moved-from component is still in the source array, and needs to be erased
+        virtual ID moveFrom(BaseComponentArray& baseSrcArray, ID id, ID ownerId) = 0;
+
+        // Moves all components out of another array of the same type, and clears it
+        // ownerIds maps the index of each source owner ID to its new owner ID
+        // The (owner ID, component ID) of each moved component is added to moved
+        // Note: Components without an owner are not moved
+        virtual void appendFrom(BaseComponentArray& baseSrcArray, const std::vector<ID>& ownerIds,
+            std::vector<std::pair<ID, ID>>& moved) = 0;
+
+        virtual ID createFor(ID ownerId) = 0;
         virtual Component& operator[] (ID id) = 0;
         virtual const Component& operator[] (ID id) const = 0;
         virtual Component* get(ID id) = 0;
@@ -32,31 +154,125 @@ class BaseComponentArray
         virtual void clear() = 0;
         virtual size_t size() const = 0;
         virtual Component& getElement(size_t i) = 0;
+        virtual size_t positions() const = 0;
+        virtual bool isAlive(size_t pos) const = 0;
+        virtual void setEraseMode(EraseMode mode) = 0;
+        virtual bool compactIfNeeded(float maxRatio, bool stable = true) = 0;
+
+        // Changes when components are added, removed, or moved (used by handles)
+        virtual uint64_t getEpoch() const = 0;
+
+        // Changes when components are added, removed, moved, or changed (used by system triggers)
+        // Note: Only changes through Entity (assign(), replace(), patch(), etc.) and
+            // markChanged() are counted, not changes through references
+        uint64_t getVersion() const
+        {
+            return getEpoch() + changes;
+        }
+
+        // Counts a change to the value of a component
+        void markChanged()
+        {
+            ++changes;
+        }
+
+        // Returns the lifecycle signals of the component type
+        // This is nullptr until something connects to them, so types without
+            // listeners only pay for checking this pointer
+        ComponentSignals* getSignals() const
+        {
+            return signals;
+        }
+
+        void setSignals(ComponentSignals* newSignals)
+        {
+            signals = newSignals;
+        }
+
+    protected:
+
+        // Prints a warning that components of a move-only type were not cloned
+        static void warnNotCloned(const std::type_index& typeIdx, size_t count);
+
+    private:
+
+        // Owned by the component pool, see ComponentPool::getSignals()
+        ComponentSignals* signals {nullptr};
+
+        // The number of value changes (the epoch counts the structural changes)
+        uint64_t changes {0};
 };
 
-// A wrapper around a PackedArray designed for storing components
+// A wrapper around a component layout's array designed for storing components
 template <class T>
 class ComponentArray: public BaseComponentArray
 {
+    using Layout = typename ComponentLayout<T>::type;
+    using OwnerKeyed = std::integral_constant<bool, Layout::ownerKeyed>;
+    using Copyable = typename std::is_copy_constructible<T>::type;
+
     public:
         ComponentArray() {}
+        explicit ComponentArray(std::pmr::memory_resource* resource): array(resource) {}
         ~ComponentArray() {}
 
-        virtual std::unique_ptr<BaseComponentArray> clone() const
+        virtual std::unique_ptr<BaseComponentArray> clone(std::pmr::memory_resource* resource) const
+        {
+            auto newArray = std::make_unique<ComponentArray<T>>(resource);
+            copyArrayTo(Copyable{}, *newArray);
+            return newArray;
+        }
+
+        ID copyFrom(const BaseComponentArray& baseSrcArray, ID id, ID ownerId)
+        {
+            return copyFrom(Copyable{}, static_cast<const ComponentArray<T>&>(baseSrcArray), id, ownerId);
+        }
+
+        bool isCopyable() const
+        {
+            return Copyable::value;
+        }
+
+        ID moveFrom(BaseComponentArray& baseSrcArray, ID id, ID ownerId)
         {
-            return std::make_unique<ComponentArray<T>>(static_cast<const ComponentArray<T>&>(*this));
+            return createFor(ownerId, std::move(static_cast<ComponentArray<T>&>(baseSrcArray)[id]));
         }
 
-        ID copyFrom(const BaseComponentArray& baseSrcArray, ID id)
+        void appendFrom(BaseComponentArray& baseSrcArray, const std::vector<ID>& ownerIds,
+            std::vector<std::pair<ID, ID>>& moved)
         {
-            return create(static_cast<const ComponentArray<T>&>(baseSrcArray)[id]);
+            auto& srcArray = static_cast<ComponentArray<T>&>(baseSrcArray);
+            array.reserve(array.size() + srcArray.size());
+            moved.reserve(moved.size() + srcArray.size());
+            for (size_t pos = 0; pos < srcArray.positions(); ++pos)
+            {
+                if (!srcArray.isAlive(pos))
+                    continue;
+                auto& comp = srcArray.getElement(pos);
+                uint32_t ownerIndex = static_cast<uint32_t>(comp.ownerId);
+                if (comp.ownerId == invalidId || ownerIndex >= ownerIds.size())
+                    continue;
+                ID ownerId = ownerIds[ownerIndex];
+                ID id = createFor(ownerId, std::move(comp));
+                array[id].ownerId = ownerId;
+                moved.emplace_back(ownerId, id);
+            }
+            srcArray.clear();
         }
 
-        ID create()
+        ID createFor(ID ownerId)
+        {
+            return createFor(OwnerKeyed{}, ownerId);
+        }
+
+        // Adds a new component for an entity, and returns the component's ID
+        template <typename... Args>
+        ID createFor(ID ownerId, Args&&... args)
         {
-            return array.create();
+            return createFor(OwnerKeyed{}, ownerId, std::forward<Args>(args)...);
         }
 
+        // Adds a new component without an owner (only for the sparse layout)
         template <typename... Args>
         ID create(Args&&... args)
         {
@@ -128,8 +344,134 @@ class ComponentArray: public BaseComponentArray
             return array.getElement(i);
         }
 
+        size_t positions() const
+        {
+            return array.positions();
+        }
+
+        bool isAlive(size_t pos) const
+        {
+            return array.isAlive(pos);
+        }
+
+        size_t slots() const
+        {
+            return array.slots();
+        }
+
+        // Returns the component in a slot (see Cursor), or nullptr if there is none
+        T* atSlot(size_t slot)
+        {
+            return array.atSlot(slot);
+        }
+
+        void setEraseMode(EraseMode mode)
+        {
+            setEraseMode(OwnerKeyed{}, mode);
+        }
+
+        void compact(bool stable = true)
+        {
+            array.compact(stable);
+        }
+
+        bool compactIfNeeded(float maxRatio, bool stable = true)
+        {
+            return compactIfNeeded(OwnerKeyed{}, maxRatio, stable);
+        }
+
+        uint64_t getEpoch() const
+        {
+            return array.getEpoch();
+        }
+
+        template <typename Compare>
+        void sort(Compare compare)
+        {
+            array.sort(compare);
+        }
+
+        template <typename KeyFunc>
+        void sortBy(KeyFunc keyFunc)
+        {
+            array.sortBy(keyFunc);
+        }
+
+        void reorder(std::vector<uint32_t> order)
+        {
+            array.reorder(std::move(order));
+        }
+
+        uint32_t getPosition(ID id) const
+        {
+            return array.getPosition(id);
+        }
+
+        void swapPositions(uint32_t a, uint32_t b)
+        {
+            array.swapPositions(a, b);
+        }
+
+        template <typename Func>
+        void forEachBlock(Func func)
+        {
+            array.forEachBlock(func);
+        }
+
     private:
-        PackedArray<T> array;
+
+        void copyArrayTo(std::true_type, ComponentArray<T>& newArray) const
+        {
+            newArray.array = array;
+        }
+
+        void copyArrayTo(std::false_type, ComponentArray<T>&) const
+        {
+            if (array.size() > 0)
+                warnNotCloned(typeid(T), array.size());
+        }
+
+        ID copyFrom(std::true_type, const ComponentArray<T>& srcArray, ID id, ID ownerId)
+        {
+            return createFor(ownerId, srcArray[id]);
+        }
+
+        ID copyFrom(std::false_type, const ComponentArray<T>&, ID, ID)
+        {
+            return invalidId;
+        }
+
+        template <typename... Args>
+        ID createFor(std::false_type, ID, Args&&... args)
+        {
+            return array.create(std::forward<Args>(args)...);
+        }
+
+        template <typename... Args>
+        ID createFor(std::true_type, ID ownerId, Args&&... args)
+        {
+            return array.createAt(ownerId, std::forward<Args>(args)...);
+        }
+
+        void setEraseMode(std::false_type, EraseMode mode)
+        {
+            array.setEraseMode(mode);
+        }
+
+        // Dense arrays always leave holes, and hash arrays always swap
+        void setEraseMode(std::true_type, EraseMode) {}
+
+        bool compactIfNeeded(std::false_type, float maxRatio, bool stable)
+        {
+            return array.compactIfNeeded(maxRatio, stable);
+        }
+
+        bool compactIfNeeded(std::true_type, float, bool)
+        {
+            return false;
+        }
+
+        typename Layout::template Array<T> array;
 };
 
 }
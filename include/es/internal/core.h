@@ -5,6 +5,7 @@
 #define ES_CORE_H
 
 #include <unordered_map>
+#include <memory_resource>
 #include <typeindex>
 #include <es/internal/packedarray.h>
 #include <es/componentpool.h>
@@ -21,7 +22,8 @@ It's named Core because it's the center of the World.
 */
 struct Core
 {
-    Core() {}
+    // Everything is allocated from the memory resource (default: global heap)
+    explicit Core(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     // Creates a new entity and returns its ID
     ID create(const std::string& name = "");
@@ -39,9 +41,19 @@ struct Core
     // Checks if an entity ID is valid
     bool isValid(ID id) const;
 
-    // Removes an entity by its ID (but not its components)
+    // Removes an entity by its ID, and any components it still has
     void remove(ID id);
 
+    // Removes all components of an entity (the destroy signals are called first)
+    void removeComponents(ID id);
+
+    // Calls the destroy signals of all components of an entity
+    void signalDestroy(ID id);
+
+    // Moves all entities and components of another Core into this one
+    // Each component array is appended in bulk, and the other Core is left empty
+    void merge(Core& srcCore);
+
     // Removes all entities
     void clear();
 
@@ -51,14 +63,29 @@ struct Core
     // Returns an entity name by ID
     const std::string& getName(ID id) const;
 
+    // Returns the ID of an entity's component (invalidId if it doesn't exist)
+    ID getCompId(ID id, const std::type_index& typeIdx) const;
+
 
 
     struct EntityData
     {
-        EntityData(const std::string& name = ""): name(name) {}
+        // Lets the entities array pass its allocator to the component sets
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        EntityData(const std::string& name = "", const allocator_type& alloc = {}):
+            compSet(alloc), name(name) {}
+        EntityData(const EntityData& other, const allocator_type& alloc):
+            compSet(other.compSet, alloc), name(other.name) {}
+        EntityData(EntityData&& other, const allocator_type& alloc):
+            compSet(std::move(other.compSet), alloc), name(std::move(other.name)) {}
+        EntityData(const EntityData& other) = default;
+        EntityData(EntityData&& other) = default;
+        EntityData& operator=(const EntityData& other) = default;
+        EntityData& operator=(EntityData&& other) = default;
 
         // The set of component IDs stored for an entity
-        std::unordered_map<std::type_index, ID> compSet;
+        std::pmr::unordered_map<std::type_index, ID> compSet;
 
         // The entity name (optional)
         std::string name;
@@ -71,7 +98,7 @@ struct Core
     PackedArray<EntityData> entities;
 
     // Maps names to entity IDs
-    std::unordered_map<std::string, ID> entityNames;
+    std::pmr::unordered_map<std::string, ID> entityNames;
 };
 
 }
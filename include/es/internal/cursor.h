@@ -0,0 +1,137 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_CURSOR_H
+#define ES_CURSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace es
+{
+
+/*
+Visits the elements of an array a few at a time, continuing where it left off.
+    Works with any array that has slots() and atSlot(), such as PackedArray,
+        component arrays, and World::getComponents().
+    The cursor goes through slots instead of positions. An element keeps its slot
+        until it is erased, even when other elements are erased or moved around,
+        so every element that exists for a whole cycle is visited exactly once per cycle.
+        Elements created during a cycle are visited in that cycle or the next one.
+    When the cursor reaches the end, the cycle is complete, and the next call
+        starts over from the beginning.
+    The cursor doesn't point to the array, so it can be kept between frames
+        (such as in a system), and passed the array each time.
+Example:
+    // Every frame, update the LOD of 100 sprites
+    lodCursor.advance(world.getComponents<Sprite>(), 100, [](Sprite& sprite) {
+        updateLod(sprite);
+    });
+*/
+class Cursor
+{
+    public:
+
+        // How many slots advance() scans for each element it can visit, by default
+        // Arrays with many erased elements have empty slots, which are skipped
+        static constexpr size_t slotsPerElement = 4;
+
+        // Calls func(element) for up to count elements, and returns the number visited
+        // Stops early at the end of a cycle, so an element is never visited twice in one call
+        // Scans up to count * slotsPerElement slots, so the cost of a call stays bounded
+            // when most of the slots are empty (the rest are scanned by the next calls)
+        template <typename Array, typename Func>
+        size_t advance(Array&& array, size_t count, Func func)
+        {
+            size_t maxSlots = (count > maxSize / slotsPerElement ? maxSize : count * slotsPerElement);
+            return advance(array, count, func, maxSlots);
+        }
+
+        // Same as above, but scans up to maxSlots slots
+        template <typename Array, typename Func>
+        size_t advance(Array&& array, size_t count, Func func, size_t maxSlots)
+        {
+            size_t visited = 0;
+            size_t slots = array.slots();
+            if (slot >= slots)
+                nextCycle();
+            size_t end = (slots - slot > maxSlots ? slot + maxSlots : slots);
+            while (visited < count && slot < end)
+            {
+                auto element = array.atSlot(slot++);
+                if (element)
+                {
+                    func(*element);
+                    ++visited;
+                }
+            }
+            if (slot >= slots)
+                nextCycle();
+            return visited;
+        }
+
+        // Calls func(element) until func returns false, or the cycle is complete
+        // This is useful with a time budget:
+            // cursor.advanceWhile(array, [&](auto& elem) { process(elem); return hasTime(); });
+        // Scans up to maxSlots slots, since func isn't called for empty slots
+        // Returns the number of elements visited
+        template <typename Array, typename Func>
+        size_t advanceWhile(Array&& array, Func func, size_t maxSlots = maxSize)
+        {
+            size_t visited = 0;
+            size_t slots = array.slots();
+            if (slot >= slots)
+                nextCycle();
+            size_t end = (slots - slot > maxSlots ? slot + maxSlots : slots);
+            bool keepGoing = true;
+            while (keepGoing && slot < end)
+            {
+                auto element = array.atSlot(slot++);
+                if (element)
+                {
+                    keepGoing = func(*element);
+                    ++visited;
+                }
+            }
+            if (slot >= slots)
+                nextCycle();
+            return visited;
+        }
+
+        // Returns the number of completed cycles
+        uint64_t getCycles() const
+        {
+            return cycles;
+        }
+
+        // Returns the slot the next call starts at
+        size_t getSlot() const
+        {
+            return slot;
+        }
+
+        // Starts over from the beginning (without completing the cycle)
+        void reset()
+        {
+            slot = 0;
+        }
+
+    private:
+
+        void nextCycle()
+        {
+            if (slot > 0)
+                ++cycles;
+            slot = 0;
+        }
+
+        static constexpr size_t maxSize = std::numeric_limits<size_t>::max();
+
+        size_t slot {0};
+        uint64_t cycles {0};
+};
+
+}
+
+#endif
@@ -0,0 +1,264 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_DENSEARRAY_H
+#define ES_DENSEARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#include <memory_resource>
+#include <es/internal/id.h>
+#include <es/internal/handle.h>
+
+namespace es
+{
+
+/*
+Stores each element at the index of its ID, with no indirection.
+    IDs aren't generated, the element's ID is chosen when creating it
+        (such as the ID of the entity that owns it)
+    Memory grows with the highest index used, not the number of elements,
+        so this is only a good fit when almost every index has an element
+    Empty positions hold default constructed elements, and are skipped when iterating
+    O(1): Add, access, update, remove
+*/
+template <class T>
+class DenseArray
+{
+    public:
+
+        // Iterates through the elements, skipping empty positions
+        template <class Array, class Elem>
+        class Iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = Elem*;
+                using reference = Elem&;
+
+                Iterator(Array* array, size_t pos): array(array), pos(pos) { skip(); }
+
+                Elem& operator*() const { return array->elements[pos]; }
+                Elem* operator->() const { return &array->elements[pos]; }
+                Iterator& operator++() { ++pos; skip(); return *this; }
+                Iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+                bool operator==(const Iterator& other) const { return pos == other.pos; }
+                bool operator!=(const Iterator& other) const { return pos != other.pos; }
+
+            private:
+                void skip()
+                {
+                    while (pos < array->ids.size() && array->ids[pos] == invalidId)
+                        ++pos;
+                }
+
+                Array* array;
+                size_t pos;
+        };
+
+        using iterator = Iterator<DenseArray, T>;
+        using const_iterator = Iterator<const DenseArray, const T>;
+
+        DenseArray() {}
+
+        // Allocates everything from a memory resource
+        explicit DenseArray(std::pmr::memory_resource* resource):
+            elements(resource),
+            ids(resource)
+        {
+        }
+
+        // Reserves space for IDs with indexes up to the capacity
+        void reserve(size_t capacity)
+        {
+            elements.reserve(capacity);
+            ids.reserve(capacity);
+            epoch.bump();
+        }
+
+        // Adds a new object at the index of an ID, and returns the ID
+        // An existing object at the same index is replaced
+        template <typename... Args>
+        ID createAt(ID id, Args&&... args)
+        {
+            uint32_t pos = static_cast<uint32_t>(id);
+            // The arguments can refer to an object in this array (such as when copying
+                // an entity in the same world), so the new object is constructed before
+                // the array grows or the old object is overwritten
+            T value(std::forward<Args>(args)...);
+            if (pos >= ids.size())
+            {
+                ids.resize(pos + 1, invalidId);
+                elements.resize(pos);
+                elements.push_back(std::move(value));
+            }
+            else
+                elements[pos] = std::move(value);
+            if (ids[pos] == invalidId)
+                ++count;
+            ids[pos] = id;
+            epoch.bump();
+            return id;
+        }
+
+        // Returns a reference to the object with the specified ID
+        // Warning: Using this with an invalid ID is undefined behavior
+        T& operator[] (ID id)
+        {
+            return elements[static_cast<uint32_t>(id)];
+        }
+
+        // Returns a const reference to the object with the specified ID
+        // Warning: Using this with an invalid ID is undefined behavior
+        const T& operator[] (ID id) const
+        {
+            return elements[static_cast<uint32_t>(id)];
+        }
+
+        // Returns a pointer to an object, or nullptr if the ID is invalid
+        T* get(ID id)
+        {
+            if (isValid(id))
+                return &operator[](id);
+            return nullptr;
+        }
+
+        // Returns a const pointer to an object, or nullptr if the ID is invalid
+        const T* get(ID id) const
+        {
+            if (isValid(id))
+                return &operator[](id);
+            return nullptr;
+        }
+
+        // Returns a handle to the object with the specified ID
+        Handle<DenseArray, T> getHandle(ID id)
+        {
+            return {this, id};
+        }
+
+        // Returns true if the ID is valid
+        bool isValid(ID id) const
+        {
+            uint32_t pos = static_cast<uint32_t>(id);
+            return (id != invalidId && pos < ids.size() && ids[pos] == id);
+        }
+
+        // Removes the object with the specified ID
+        // The object is reset to a default constructed one, to free its resources
+        void erase(ID id)
+        {
+            if (isValid(id))
+            {
+                uint32_t pos = static_cast<uint32_t>(id);
+                elements[pos] = T();
+                ids[pos] = invalidId;
+                --count;
+                epoch.bump();
+
+                // Empty positions at the end don't need to be kept
+                while (!ids.empty() && ids.back() == invalidId)
+                {
+                    ids.pop_back();
+                    elements.pop_back();
+                }
+            }
+        }
+
+        // Clears all of the elements
+        void clear()
+        {
+            elements.clear();
+            ids.clear();
+            count = 0;
+            epoch.bump();
+        }
+
+        // Returns the structural epoch, which changes when any element is added or removed
+        uint64_t getEpoch() const
+        {
+            return epoch.get();
+        }
+
+        // Returns the number of elements (not including empty positions)
+        size_t size() const
+        {
+            return count;
+        }
+
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, ids.size()}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, ids.size()}; }
+        const_iterator cbegin() const { return {this, 0}; }
+        const_iterator cend() const { return {this, ids.size()}; }
+
+        // Returns an element directly (for polymorphic iteration)
+        // Note: This can be an empty position, use isAlive() to check
+        T& getElement(size_t i)
+        {
+            return elements[i];
+        }
+
+        // Returns the number of element positions (including empty ones)
+        size_t positions() const
+        {
+            return ids.size();
+        }
+
+        // Returns true if there is an element at a position
+        bool isAlive(size_t pos) const
+        {
+            return ids[pos] != invalidId;
+        }
+
+        // Returns the number of slots (same as positions(), elements never move)
+        size_t slots() const
+        {
+            return ids.size();
+        }
+
+        // Returns the element in a slot, or nullptr if the slot is empty
+        T* atSlot(size_t slot)
+        {
+            return (ids[slot] != invalidId ? &elements[slot] : nullptr);
+        }
+
+        // Calls func(data, count) for each run of elements without empty positions
+        template <typename Func>
+        void forEachBlock(Func func)
+        {
+            size_t pos = 0;
+            while (pos < ids.size())
+            {
+                while (pos < ids.size() && ids[pos] == invalidId)
+                    ++pos;
+                size_t start = pos;
+                while (pos < ids.size() && ids[pos] != invalidId)
+                    ++pos;
+                if (pos > start)
+                    func(&elements[start], pos - start);
+            }
+        }
+
+    private:
+
+        // Elements, at the index of their ID
+        std::pmr::vector<T> elements;
+
+        // The full ID of each position, or invalidId if the position is empty
+        std::pmr::vector<ID> ids;
+
+        // Number of positions that aren't empty
+        size_t count {0};
+
+        Epoch epoch;
+};
+
+}
+
+#endif
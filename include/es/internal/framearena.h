@@ -0,0 +1,74 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_FRAMEARENA_H
+#define ES_FRAMEARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <memory_resource>
+
+namespace es
+{
+
+/*
+A linear allocator for temporary data that only lives until the end of a frame.
+    Allocating only moves an offset forward, and deallocating does nothing.
+    reset() frees everything at once, but keeps the memory for the next frame,
+        so once the arena has grown enough for a frame, it stops allocating.
+    Not thread safe.
+*/
+class FrameArena: public std::pmr::memory_resource
+{
+    public:
+
+        explicit FrameArena(size_t initialSize = 64 * 1024,
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // Frees everything allocated from the arena (the memory is kept)
+        void reset();
+
+        // Frees everything, and gives the memory back to the upstream resource
+        void release();
+
+        // Returns the number of bytes the arena has allocated from upstream
+        size_t capacity() const;
+
+        // Returns the number of bytes used since the last reset
+        size_t used() const;
+
+    private:
+
+        void* do_allocate(size_t bytes, size_t alignment);
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment);
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept;
+
+        // Returns nullptr if the current block doesn't have enough space
+        void* allocateFromCurrent(size_t bytes, size_t alignment);
+
+        struct Block
+        {
+            unsigned char* data;
+            size_t size;
+        };
+
+        std::vector<Block> blocks;
+
+        // Position in the blocks where the next allocation starts
+        size_t current {0};
+        size_t offset {0};
+
+        // Bytes used in the blocks before the current one
+        size_t usedBefore {0};
+
+        size_t initialSize;
+        std::pmr::memory_resource* upstream;
+};
+
+}
+
+#endif
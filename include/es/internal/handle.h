@@ -4,12 +4,43 @@
 #ifndef ES_HANDLE_H
 #define ES_HANDLE_H
 
+#include <cstdint>
+#include <algorithm>
 #include <es/internal/id.h>
 
 namespace es
 {
 
-// A smart handle that can access an element from a PackedArray-like container
+/*
+A counter that changes whenever elements are added, removed, or moved around in a container.
+    Pointers to elements stay valid as long as the epoch stays the same.
+    Assigning a container to another one also changes the epoch, so the new
+        elements never have the same epoch as the old ones.
+*/
+class Epoch
+{
+    public:
+        Epoch() {}
+        Epoch(const Epoch& other): value(other.value) {}
+
+        Epoch& operator=(const Epoch& other)
+        {
+            value = std::max(value, other.value) + 1;
+            return *this;
+        }
+
+        void bump() { ++value; }
+        uint64_t get() const { return value; }
+
+    private:
+        uint64_t value {0};
+};
+
+/*
+A smart handle that can access an element from a PackedArray-like container
+    The element pointer is cached, and only looked up again when the container's epoch
+        changes, so dereferencing the same handle many times only costs one lookup.
+*/
 template <class Container, class T>
 class Handle
 {
@@ -17,25 +48,43 @@ class Handle
         Handle(Container* array, ID id): array(array), id(id) {}
 
         // Check if handle is valid
-        bool valid() const { return array && array->isValid(id); }
+        bool valid() const { return lookup() != nullptr; }
         operator bool() const { return valid(); }
 
         // Erase element that handle is pointing to
         void erase() { if (array) array->erase(id); }
 
         // Dereference handle
-        T& access() { return (*array)[id]; }
-        const T& access() const { return (*array)[id]; }
-        T* operator-> () { return &((*array)[id]); }
-        T& operator* () { return (*array)[id]; }
+        T& access() { return *lookup(); }
+        const T& access() const { return *lookup(); }
+        T* operator-> () { return lookup(); }
+        T& operator* () { return *lookup(); }
 
         // Return pointer to element
-        T* get() { return array ? array->get(id) : nullptr; }
-        const T* get() const { return array ? array->get(id) : nullptr; }
+        T* get() { return lookup(); }
+        const T* get() const { return lookup(); }
 
     private:
+
+        // Returns the cached pointer, or looks it up again if the epoch changed
+        T* lookup() const
+        {
+            if (!array)
+                return nullptr;
+            uint64_t epoch = array->getEpoch();
+            if (epoch != cachedEpoch)
+            {
+                cached = array->get(id);
+                cachedEpoch = epoch;
+            }
+            return cached;
+        }
+
         Container* array;
         ID id;
+
+        mutable T* cached {nullptr};
+        mutable uint64_t cachedEpoch {static_cast<uint64_t>(-1)};
 };
 
 }
@@ -0,0 +1,241 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_HASHARRAY_H
+#define ES_HASHARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <memory_resource>
+#include <es/internal/id.h>
+#include <es/internal/handle.h>
+#include <es/internal/storage.h>
+#include <es/internal/packedindex.h>
+
+namespace es
+{
+
+/*
+Packed elements, with a hash table from the index of their ID to their position.
+    IDs aren't generated, the element's ID is chosen when creating it
+        (such as the ID of the entity that owns it)
+    Memory only depends on the number of elements, there is no index that stays
+        at the highest ID or the peak number of elements
+    Lookups cost a hash, so this is best for elements that very few IDs have
+    O(1) average: Add, access, update, remove
+*/
+template <class T>
+class HashArray
+{
+    public:
+
+        using iterator = typename std::pmr::vector<T>::iterator;
+        using const_iterator = typename std::pmr::vector<T>::const_iterator;
+
+        HashArray() {}
+
+        // Allocates everything from a memory resource
+        explicit HashArray(std::pmr::memory_resource* resource):
+            elements(resource),
+            ids(resource),
+            lookup(resource)
+        {
+        }
+
+        // Reserves space for a total number of objects
+        void reserve(size_t capacity)
+        {
+            elements.reserve(capacity);
+            ids.reserve(capacity);
+            lookup.reserve(capacity);
+            epoch.bump();
+        }
+
+        // Adds a new object for an ID, and returns the ID
+        // An existing object with the same index is replaced
+        template <typename... Args>
+        ID createAt(ID id, Args&&... args)
+        {
+            // The arguments can refer to an object in this array (such as when copying
+                // an entity in the same world), so the new object is constructed before
+                // the array grows or the old object is overwritten
+            T value(std::forward<Args>(args)...);
+            uint32_t key = static_cast<uint32_t>(id);
+            auto found = lookup.find(key);
+            if (found != lookup.end())
+            {
+                elements[found->second] = std::move(value);
+                ids[found->second] = id;
+            }
+            else
+            {
+                lookup.emplace(key, static_cast<uint32_t>(elements.size()));
+                elements.push_back(std::move(value));
+                ids.push_back(id);
+                slotCount = std::max<size_t>(slotCount, size_t(key) + 1);
+            }
+            epoch.bump();
+            return id;
+        }
+
+        // Returns a reference to the object with the specified ID
+        // Warning: Using this with an invalid ID is undefined behavior
+        T& operator[] (ID id)
+        {
+            return elements[lookup.find(static_cast<uint32_t>(id))->second];
+        }
+
+        // Returns a const reference to the object with the specified ID
+        // Warning: Using this with an invalid ID is undefined behavior
+        const T& operator[] (ID id) const
+        {
+            return elements[lookup.find(static_cast<uint32_t>(id))->second];
+        }
+
+        // Returns a pointer to an object, or nullptr if the ID is invalid
+        T* get(ID id)
+        {
+            uint32_t pos = find(id);
+            return (pos != u32Max ? &elements[pos] : nullptr);
+        }
+
+        // Returns a const pointer to an object, or nullptr if the ID is invalid
+        const T* get(ID id) const
+        {
+            uint32_t pos = find(id);
+            return (pos != u32Max ? &elements[pos] : nullptr);
+        }
+
+        // Returns a handle to the object with the specified ID
+        Handle<HashArray, T> getHandle(ID id)
+        {
+            return {this, id};
+        }
+
+        // Returns true if the ID is valid
+        bool isValid(ID id) const
+        {
+            return (find(id) != u32Max);
+        }
+
+        // Removes the object with the specified ID
+        void erase(ID id)
+        {
+            uint32_t pos = find(id);
+            if (pos != u32Max)
+            {
+                lookup.erase(static_cast<uint32_t>(id));
+
+                // Overwrite element with last element
+                uint32_t last = elements.size() - 1;
+                if (pos != last)
+                {
+                    elements[pos] = std::move(elements[last]);
+                    ids[pos] = ids[last];
+                    lookup[static_cast<uint32_t>(ids[pos])] = pos;
+                }
+                elements.pop_back();
+                ids.pop_back();
+                epoch.bump();
+            }
+        }
+
+        // Clears all of the elements
+        void clear()
+        {
+            elements.clear();
+            ids.clear();
+            lookup.clear();
+            slotCount = 0;
+            epoch.bump();
+        }
+
+        // Returns the structural epoch, which changes when any element is added or removed
+        uint64_t getEpoch() const
+        {
+            return epoch.get();
+        }
+
+        // Returns the number of elements
+        size_t size() const
+        {
+            return elements.size();
+        }
+
+        iterator begin() { return elements.begin(); }
+        iterator end() { return elements.end(); }
+        const_iterator begin() const { return elements.begin(); }
+        const_iterator end() const { return elements.end(); }
+        const_iterator cbegin() const { return elements.cbegin(); }
+        const_iterator cend() const { return elements.cend(); }
+
+        // Returns an element directly (for polymorphic iteration)
+        T& getElement(size_t i)
+        {
+            return elements[i];
+        }
+
+        // Returns the number of element positions (same as size(), there are no holes)
+        size_t positions() const
+        {
+            return elements.size();
+        }
+
+        bool isAlive(size_t) const
+        {
+            return true;
+        }
+
+        // Returns the number of slots (the index part of every ID is below this)
+        // Note: Slots are the indexes of the IDs, so this depends on the highest ID used,
+            // not on the number of elements
+        size_t slots() const
+        {
+            return slotCount;
+        }
+
+        // Returns the element in a slot, or nullptr if there is none
+        T* atSlot(size_t slot)
+        {
+            auto found = lookup.find(static_cast<uint32_t>(slot));
+            return (found != lookup.end() ? &elements[found->second] : nullptr);
+        }
+
+        // Calls func(data, count) for the elements
+        template <typename Func>
+        void forEachBlock(Func func)
+        {
+            es::forEachBlock(elements, func);
+        }
+
+    private:
+
+        // Returns the position of an ID, or u32Max if it's invalid
+        uint32_t find(ID id) const
+        {
+            auto found = lookup.find(static_cast<uint32_t>(id));
+            if (found != lookup.end() && ids[found->second] == id)
+                return found->second;
+            return u32Max;
+        }
+
+        std::pmr::vector<T> elements;
+
+        // The full ID of each element
+        std::pmr::vector<ID> ids;
+
+        // Index of ID to element position
+        std::pmr::unordered_map<uint32_t, uint32_t> lookup;
+
+        // Highest index of an ID used since the last clear, plus one
+        size_t slotCount {0};
+
+        Epoch epoch;
+};
+
+}
+
+#endif
@@ -30,11 +30,19 @@ Linked list:
     End of list
         Used = false
         Index = Max
+
+The "used" flag is stored in the highest bit of the version (set when unused),
+    so a PID is only 8 bytes. This leaves 31 bits for the version.
+    IDs from the index never have this bit set, and isValid() rejects IDs that do,
+    so an unused entry never matches an ID, even a stale or made up one.
 */
 
 // PackedArray ID
 struct PID
 {
+    static const uint32_t unusedBit = 0x80000000u;
+    static const uint32_t versionMask = ~unusedBit;
+
     PID():
         version(1),
         index(0)
@@ -58,13 +66,29 @@ struct PID
     }
 
     // Handles wraparound, so version is always valid
+    // Note: Preserves the used flag
     void incVersion()
     {
-        if (!++version)
+        uint32_t flags = version & unusedBit;
+        version = (version + 1) & versionMask;
+        if (!version)
             version = 1;
+        version |= flags;
+    }
+
+    bool used() const
+    {
+        return !(version & unusedBit);
+    }
+
+    void setUsed(bool used)
+    {
+        if (used)
+            version &= versionMask;
+        else
+            version |= unusedBit;
     }
 
-    bool used {true};
     uint32_t version;
     uint32_t index;
 };
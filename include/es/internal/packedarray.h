@@ -4,16 +4,36 @@
 #ifndef ES_PACKEDARRAY_H
 #define ES_PACKEDARRAY_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
-#include <limits>
+#include <iterator>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
 #include <es/internal/id.h>
 #include <es/internal/handle.h>
+#include <es/internal/storage.h>
+#include <es/internal/packedindex.h>
+#include <es/internal/radixsort.h>
 
 namespace es
 {
 
-const uint32_t u32Max = std::numeric_limits<uint32_t>::max();
+// How PackedArray removes elements
+enum class EraseMode
+{
+    // Moves the last element into the hole (default)
+    Swap,
+
+    // Leaves a tombstone in place of the element, which is skipped when
+    // iterating, until the holes are removed with compact()
+    // This keeps the order of the elements, and doesn't move anything when erasing
+    // Erased elements are assigned a default constructed value, which frees what they hold
+    // Note: Types that can't be default constructed and move assigned keep their value
+        // until compact() is called
+    Tombstone
+};
 
 /*
 PackedArray 3.0
@@ -23,18 +43,70 @@ PackedArray 3.0
         The version is incremented each time the index is erased
     Free list stored inside holes of index
         No memory allocations when erasing elements
+    Index policy selects how IDs are mapped to elements (see packedindex.h)
+        DenseIndex: One entry per slot ever used (default)
+        PagedIndex: Pages allocated on demand, and freed when they're empty
+    Can allocate from a std::pmr::memory_resource, such as an arena
     Generic "handles", which are smart pointers that don't invalidate when reallocating memory
         The lookup is done when using the handle
         The handle stores the ID instead of a raw pointer
     Supports directly iterating through internal array
+    Storage policy selects the container type (see storage.h)
+        VectorStorage: Single contiguous array (default)
+        ChunkedStorage: Fixed-size chunks, growing never moves elements
+        ReservedStorage: Contiguous reserved virtual memory, growing never copies
+    Erase mode can be switched to tombstones (see EraseMode)
+    Elements can be sorted in place without changing their IDs
 */
-template <class T>
+template <class T, class Storage = VectorStorage, class Index = DenseIndex<Storage>>
 class PackedArray
 {
     public:
 
+        // Iterates through the elements, skipping any tombstones
+        template <class Array, class Elem>
+        class Iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = Elem*;
+                using reference = Elem&;
+
+                Iterator(Array* array, size_t pos): array(array), pos(pos) { skip(); }
+
+                Elem& operator*() const { return array->elements[pos]; }
+                Elem* operator->() const { return &array->elements[pos]; }
+                Iterator& operator++() { ++pos; skip(); return *this; }
+                Iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+                bool operator==(const Iterator& other) const { return pos == other.pos; }
+                bool operator!=(const Iterator& other) const { return pos != other.pos; }
+
+            private:
+                void skip()
+                {
+                    while (array->tombstones && pos < array->elements.size() && array->reverseLookup[pos] == u32Max)
+                        ++pos;
+                }
+
+                Array* array;
+                size_t pos;
+        };
+
+        using iterator = Iterator<PackedArray, T>;
+        using const_iterator = Iterator<const PackedArray, const T>;
+
         PackedArray() {}
 
+        // Allocates everything from a memory resource
+        explicit PackedArray(std::pmr::memory_resource* resource):
+            index(resource),
+            elements(resource),
+            reverseLookup(resource)
+        {
+        }
+
         PackedArray(size_t spaceToReserve)
         {
             index.reserve(spaceToReserve);
@@ -42,12 +114,22 @@ class PackedArray
             reverseLookup.reserve(spaceToReserve);
         }
 
+        // Reserves space for a total number of objects
+        void reserve(size_t capacity)
+        {
+            index.reserve(capacity);
+            elements.reserve(capacity);
+            reverseLookup.reserve(capacity);
+            epoch.bump();
+        }
+
         // Adds a new object and returns its ID
         template <typename... Args>
         ID create(Args&&... args)
         {
             uint32_t pos = elements.size();
             elements.emplace_back(std::forward<Args>(args)...);
+            epoch.bump();
             return addToIndex(pos);
         }
 
@@ -84,13 +166,13 @@ class PackedArray
         }
 
         // Returns a handle to the object with the specified ID
-        Handle<PackedArray<T>, T> getHandle(ID id)
+        Handle<PackedArray, T> getHandle(ID id)
         {
             return {this, id};
         }
 
         // Returns a const handle to the object with the specified ID
-        const Handle<const PackedArray<T>, const T> getHandle(ID id) const
+        const Handle<const PackedArray, const T> getHandle(ID id) const
         {
             return {this, id};
         }
@@ -98,11 +180,7 @@ class PackedArray
         // Returns true if the ID is valid
         bool isValid(ID id) const
         {
-            PID pid{id};
-            return (pid.version &&
-                    pid.index < index.size() &&
-                    index[pid.index].used &&
-                    index[pid.index].version == pid.version);
+            return index.isValid(PID{id});
         }
 
         // Removes the object with the specified ID
@@ -112,9 +190,20 @@ class PackedArray
             {
                 PID pid{id};
                 uint32_t pos = index[pid.index].index;
+                epoch.bump();
 
                 // Adds to free list, marks as unused, increments version
-                removeFromIndex(pid.index);
+                index.remove(pid.index);
+
+                if (eraseMode == EraseMode::Tombstone && pos + 1 < elements.size())
+                {
+                    // Leave the element in place, and mark it as a tombstone
+                    // The element is reset, so whatever it holds is freed right away
+                    reverseLookup[pos] = u32Max;
+                    resetTombstone(Resettable{}, elements[pos]);
+                    ++tombstones;
+                    return;
+                }
 
                 // Overwrite element with last element
                 uint32_t swappedPos = swapErase(elements, pos);
@@ -125,96 +214,322 @@ class PackedArray
 
                 // Remove position from reverse lookup
                 swapErase(reverseLookup, pos);
+
+                // Tombstones at the end don't need to be kept
+                popTombstones();
             }
         }
 
         // Clears all of the elements and IDs
         void clear()
         {
-            head = u32Max;
             index.clear();
             elements.clear();
             reverseLookup.clear();
+            tombstones = 0;
+            epoch.bump();
         }
 
-        // Returns the number of elements
+        // Returns the number of elements (not including tombstones)
         size_t size() const
         {
-            return elements.size();
+            return elements.size() - tombstones;
         }
 
         // Iterators for the internal elements array
-        auto begin() { return elements.begin(); }
-        auto end() { return elements.end(); }
-        auto cbegin() const { return elements.cbegin(); }
-        auto cend() const { return elements.cend(); }
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, elements.size()}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, elements.size()}; }
+        const_iterator cbegin() const { return {this, 0}; }
+        const_iterator cend() const { return {this, elements.size()}; }
 
         // Returns an element directly (for polymorphic iteration)
+        // Note: This can be a tombstone, use isAlive() to check
         T& getElement(size_t i)
         {
             return elements[i];
         }
 
+        // Returns the number of element positions (including tombstones)
+        size_t positions() const
+        {
+            return elements.size();
+        }
+
+        // Returns true if the element at a position isn't a tombstone
+        bool isAlive(size_t pos) const
+        {
+            return reverseLookup[pos] != u32Max;
+        }
+
+        // Returns the number of slots (the index part of every ID is below this)
+        size_t slots() const
+        {
+            return index.slots();
+        }
+
+        // Returns the element in a slot, or nullptr if the slot is free
+        // An element keeps its slot until it is erased, no matter how it is moved
+        T* atSlot(size_t slot)
+        {
+            PID pid = index.entry(static_cast<uint32_t>(slot));
+            return (pid.used() ? &elements[pid.index] : nullptr);
+        }
+
+        // Sets how elements are erased
+        // Note: Switching back to EraseMode::Swap removes all tombstones
+        void setEraseMode(EraseMode mode)
+        {
+            if (mode == EraseMode::Swap)
+                compact(false);
+            eraseMode = mode;
+        }
+
+        EraseMode getEraseMode() const
+        {
+            return eraseMode;
+        }
+
+        // Returns the number of tombstones
+        size_t getTombstones() const
+        {
+            return tombstones;
+        }
+
+        // Removes all tombstones
+        // Stable: Moves all elements down, keeping their order
+        // Unstable: Fills holes with elements from the end, which moves fewer elements
+        void compact(bool stable = true)
+        {
+            if (!tombstones)
+                return;
+            epoch.bump();
+            uint32_t count = elements.size();
+            uint32_t dest = 0;
+            if (stable)
+            {
+                for (uint32_t src = 0; src < count; ++src)
+                {
+                    if (isAlive(src))
+                    {
+                        if (src != dest)
+                            moveElement(src, dest);
+                        ++dest;
+                    }
+                }
+            }
+            else
+            {
+                uint32_t src = count;
+                while (true)
+                {
+                    while (dest < src && isAlive(dest))
+                        ++dest;
+                    while (src > dest && !isAlive(src - 1))
+                        --src;
+                    if (dest + 1 >= src)
+                        break;
+                    moveElement(--src, dest++);
+                }
+                dest = src;
+            }
+            while (elements.size() > dest)
+            {
+                elements.pop_back();
+                reverseLookup.pop_back();
+            }
+            tombstones = 0;
+        }
+
+        // Removes all tombstones if they make up more than the specified ratio
+        // Returns true if the array was compacted
+        bool compactIfNeeded(float maxRatio, bool stable = true)
+        {
+            if (tombstones && tombstones > maxRatio * elements.size())
+            {
+                compact(stable);
+                return true;
+            }
+            return false;
+        }
+
+        // Sorts the elements with a comparison function (not stable)
+        // IDs stay the same, only the positions of the elements change
+        // Note: Tombstones are removed first
+        template <typename Compare>
+        void sort(Compare compare)
+        {
+            compact();
+            std::vector<uint32_t> order(elements.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return compare(elements[a], elements[b]);
+            });
+            reorder(std::move(order));
+        }
+
+        // Sorts the elements by a key returned from keyFunc(element) (stable)
+        // Integer and floating point keys are radix sorted
+        // Note: Tombstones are removed first
+        template <typename KeyFunc>
+        void sortBy(KeyFunc keyFunc)
+        {
+            using Key = typename std::decay<decltype(keyFunc(std::declval<T&>()))>::type;
+            compact();
+            std::vector<Key> keys;
+            keys.reserve(elements.size());
+            for (size_t i = 0; i < elements.size(); ++i)
+                keys.push_back(keyFunc(elements[i]));
+            reorder(sortOrder(keys, std::integral_constant<bool, IsRadixKey<Key>::value>{}));
+        }
+
+        // Returns the position of an element in the internal array
+        // Warning: Using this with an invalid ID is undefined behavior
+        uint32_t getPosition(ID id) const
+        {
+            return index[static_cast<uint32_t>(id)].index;
+        }
+
+        // Swaps the elements at two positions (neither can be a tombstone)
+        void swapPositions(uint32_t a, uint32_t b)
+        {
+            using std::swap;
+            swap(elements[a], elements[b]);
+            swap(reverseLookup[a], reverseLookup[b]);
+            index[reverseLookup[a]].index = a;
+            index[reverseLookup[b]].index = b;
+            epoch.bump();
+        }
+
+        // Rearranges the elements in place, where order[newPosition] = oldPosition
+        // The order must contain every position once, and there can't be any tombstones
+        // Note: Follows the cycles of the permutation, so only one element is held aside
+            // at a time, and no second array is allocated. The order is used to mark the
+            // positions that are done, so it is taken by value.
+        void reorder(std::vector<uint32_t> order)
+        {
+            for (uint32_t start = 0; start < order.size(); ++start)
+            {
+                if (order[start] == start)
+                    continue;
+
+                // Shift each element of the cycle into place, then put the first one at the end
+                T value = std::move(elements[start]);
+                uint32_t lookup = reverseLookup[start];
+                uint32_t pos = start;
+                while (order[pos] != start)
+                {
+                    uint32_t next = order[pos];
+                    elements[pos] = std::move(elements[next]);
+                    reverseLookup[pos] = reverseLookup[next];
+                    index[reverseLookup[pos]].index = pos;
+                    order[pos] = pos;
+                    pos = next;
+                }
+                elements[pos] = std::move(value);
+                reverseLookup[pos] = lookup;
+                index[lookup].index = pos;
+                order[pos] = pos;
+            }
+            epoch.bump();
+        }
+
+        // Returns the structural epoch, which changes when any element is
+        // added, removed, or moved (pointers to elements are valid until then)
+        uint64_t getEpoch() const
+        {
+            return epoch.get();
+        }
+
+        // Calls func(T* data, size_t count) for each contiguous block of elements
+        // Note: The blocks include tombstones, so call compact() first if there are any
+        template <typename Func>
+        void forEachBlock(Func func)
+        {
+            es::forEachBlock(elements, func);
+        }
+
         // Returns all of the currently used IDs
         std::vector<ID> getIndex() const
         {
             std::vector<ID> ids;
-            uint32_t count = 0;
-            for (const auto& pid: index)
-            {
-                if (pid.used)
-                    ids.push_back(PID{pid.version, count}.id());
-                ++count;
-            }
+            ids.reserve(size());
+            index.forEachUsed([&](PID pid) { ids.push_back(pid.id()); });
+            return ids;
+        }
+
+        // Returns all of the currently used IDs, allocated from a memory resource
+        std::pmr::vector<ID> getIndex(std::pmr::memory_resource* resource) const
+        {
+            std::pmr::vector<ID> ids(resource);
+            ids.reserve(size());
+            index.forEachUsed([&](PID pid) { ids.push_back(pid.id()); });
             return ids;
         }
 
     private:
 
-        // Adds to free list, marks as unused, increments version
-        // (Index position)
-        void removeFromIndex(uint32_t pos)
+        using Resettable = std::integral_constant<bool,
+            std::is_default_constructible<T>::value && std::is_move_assignable<T>::value>;
+
+        static void resetTombstone(std::true_type, T& elem)
         {
-            // Increment version and mark as unused
-            auto& idx = index[pos];
-            idx.incVersion();
-            idx.used = false;
+            elem = T();
+        }
+
+        static void resetTombstone(std::false_type, T&) {}
 
-            // Add to free list
-            idx.index = head;
-            head = pos;
+        template <typename Key>
+        static std::vector<uint32_t> sortOrder(const std::vector<Key>& keys, std::true_type)
+        {
+            return radixSortOrder(keys);
+        }
+
+        template <typename Key>
+        static std::vector<uint32_t> sortOrder(const std::vector<Key>& keys, std::false_type)
+        {
+            std::vector<uint32_t> order(keys.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return keys[a] < keys[b];
+            });
+            return order;
+        }
+
+        // Moves an element to another position, and updates the lookup tables
+        void moveElement(uint32_t src, uint32_t dest)
+        {
+            elements[dest] = std::move(elements[src]);
+            reverseLookup[dest] = reverseLookup[src];
+            reverseLookup[src] = u32Max;
+            index[reverseLookup[dest]].index = dest;
+        }
+
+        // Removes any tombstones from the end
+        void popTombstones()
+        {
+            while (tombstones && reverseLookup.size() && reverseLookup.back() == u32Max)
+            {
+                elements.pop_back();
+                reverseLookup.pop_back();
+                --tombstones;
+            }
         }
 
         // Updates the index to point to the specified (elements) position
         // Also updates the reverse lookup table
         ID addToIndex(uint32_t pos)
         {
-            PID pid;
-            if (head == u32Max)
-            {
-                // Index has no holes, so add ID to the end
-                pid.index = index.size();
-                index.emplace_back(1, pos);
-            }
-            else
-            {
-                // Reuse the first ID from the free list (pop it off)
-                // Note: Version is different from previous erase
-                auto& idx = index[head];
-                pid.version = idx.version;
-                pid.index = head;
-                head = idx.index;
-                idx.index = pos;
-                idx.used = true;
-            }
+            PID pid = index.add(pos);
             reverseLookup.push_back(pid.index);
             return pid.id();
         }
 
         // This function overwrites the specified element with the last element
         // Returns the position of the element that was moved, or invalid if nothing else was affected
-        template <typename A>
-        uint32_t swapErase(std::vector<A>& elements, uint32_t pos)
+        template <typename Container>
+        uint32_t swapErase(Container& elements, uint32_t pos)
         {
             uint32_t oldPos = u32Max;
             uint32_t elemSize = elements.size();
@@ -234,20 +549,25 @@ class PackedArray
             return oldPos;
         }
 
-        // Position of first node of linked list, in the holes of the index
-        uint32_t head {u32Max};
-
         // External position to internal position and version
-        // Also contains the free list inside of the "holes"
-        std::vector<PID> index;
+        // Also keeps track of the free IDs
+        Index index;
 
         // Actual elements are stored here
         // This has no "holes", because it's "packed"
-        std::vector<T> elements;
+        typename Storage::template Array<T> elements;
 
         // Used to update index when elements are swapped
         // Parallel to elements vector
-        std::vector<uint32_t> reverseLookup;
+        // Tombstones are marked with u32Max
+        typename Storage::template Array<uint32_t> reverseLookup;
+
+        EraseMode eraseMode {EraseMode::Swap};
+
+        // Number of tombstones in the elements
+        uint32_t tombstones {0};
+
+        Epoch epoch;
 };
 
 }
@@ -0,0 +1,439 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_PACKEDINDEX_H
+#define ES_PACKEDINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <limits>
+#include <algorithm>
+#include <es/internal/id.h>
+#include <es/internal/storage.h>
+
+namespace es
+{
+
+const uint32_t u32Max = std::numeric_limits<uint32_t>::max();
+
+/*
+Index policies for PackedArray.
+An index maps the index part of an ID (a "slot") to the position of the element,
+    and keeps track of which slots are free.
+Interface:
+    PID& operator[](slot): Entry of a used slot (index = element position)
+    bool isValid(PID): True if the slot is used with the same version (IDs with the
+        unused bit set are never valid)
+    PID add(pos): Uses a free slot for an element position
+    void remove(slot): Frees a slot and increments its version
+    size_t slots(): Upper bound of the slots
+    PID entry(slot): Entry of any slot below slots(), or an unused entry
+    forEachUsed(func): Calls func(PID) for each used slot, with PID.index = slot
+Indexes can be constructed from a std::pmr::memory_resource to allocate from.
+*/
+
+/*
+One entry for every slot ever used, stored in a single array.
+    Free list stored inside holes of the index
+    Never shrinks, so it stays at the peak number of elements
+*/
+template <class Storage = VectorStorage>
+class DenseIndex
+{
+    public:
+
+        DenseIndex() {}
+
+        explicit DenseIndex(std::pmr::memory_resource* resource):
+            entries(resource)
+        {
+        }
+
+        PID& operator[] (uint32_t slot)
+        {
+            return entries[slot];
+        }
+
+        const PID& operator[] (uint32_t slot) const
+        {
+            return entries[slot];
+        }
+
+        bool isValid(PID pid) const
+        {
+            // IDs with the unused bit set are rejected, since they could match a free slot
+            return (pid.version && pid.used() &&
+                    pid.index < entries.size() &&
+                    entries[pid.index].version == pid.version);
+        }
+
+        PID add(uint32_t pos)
+        {
+            PID pid;
+            if (head == u32Max)
+            {
+                // Index has no holes, so add ID to the end
+                pid.index = entries.size();
+                entries.emplace_back(1, pos);
+            }
+            else
+            {
+                // Reuse the first ID from the free list (pop it off)
+                // Note: Version is different from previous erase
+                auto& idx = entries[head];
+                idx.setUsed(true);
+                pid.version = idx.version;
+                pid.index = head;
+                head = idx.index;
+                idx.index = pos;
+            }
+            return pid;
+        }
+
+        void remove(uint32_t slot)
+        {
+            // Increment version and mark as unused
+            auto& idx = entries[slot];
+            idx.incVersion();
+            idx.setUsed(false);
+
+            // Add to free list
+            idx.index = head;
+            head = slot;
+        }
+
+        void clear()
+        {
+            head = u32Max;
+            entries.clear();
+        }
+
+        void reserve(size_t capacity)
+        {
+            entries.reserve(capacity);
+        }
+
+        size_t slots() const
+        {
+            return entries.size();
+        }
+
+        PID entry(uint32_t slot) const
+        {
+            return entries[slot];
+        }
+
+        template <typename Func>
+        void forEachUsed(Func func) const
+        {
+            uint32_t count = 0;
+            for (const auto& pid: entries)
+            {
+                if (pid.used())
+                    func(PID{pid.version, count});
+                ++count;
+            }
+        }
+
+    private:
+
+        // Position of first node of linked list, in the holes of the index
+        uint32_t head {u32Max};
+
+        // External position to internal position and version
+        // Also contains the free list inside of the "holes"
+        typename Storage::template Array<PID> entries;
+};
+
+/*
+A sparse index made of fixed-size pages.
+    Pages are allocated when a slot in them is first needed, and freed again
+        as soon as all of their slots are unused.
+    Each page has its own free list, and pages with free slots are kept in a stack.
+    A freed page remembers a minimum version for its slots, so IDs are never
+        reused with the same version after the page is allocated again.
+    One freed page is kept as a spare, so erasing and creating the same element
+        repeatedly doesn't allocate memory every time.
+    Only a small header per page is kept for the whole slot range.
+*/
+template <size_t PageSize = 4096>
+class PagedIndex
+{
+    static_assert(PageSize && !(PageSize & (PageSize - 1)), "PageSize must be a power of two.");
+
+    public:
+
+        PagedIndex() {}
+
+        explicit PagedIndex(std::pmr::memory_resource* resource):
+            pages(resource),
+            freePages(resource),
+            resource(resource)
+        {
+        }
+
+        // Like the standard containers, copies use the default memory resource
+        PagedIndex(const PagedIndex& other):
+            freePages(other.freePages)
+        {
+            copyPages(other);
+        }
+
+        PagedIndex(PagedIndex&& other) = default;
+
+        PagedIndex& operator=(const PagedIndex& other)
+        {
+            if (this != &other)
+            {
+                freePages = other.freePages;
+                copyPages(other);
+            }
+            return *this;
+        }
+
+        PagedIndex& operator=(PagedIndex&& other) = default;
+
+        PID& operator[] (uint32_t slot)
+        {
+            return pages[slot / PageSize].entries[slot & (PageSize - 1)];
+        }
+
+        const PID& operator[] (uint32_t slot) const
+        {
+            return pages[slot / PageSize].entries[slot & (PageSize - 1)];
+        }
+
+        bool isValid(PID pid) const
+        {
+            size_t page = pid.index / PageSize;
+            return (pid.version && pid.used() &&
+                    page < pages.size() &&
+                    pages[page].entries &&
+                    pages[page].entries[pid.index & (PageSize - 1)].version == pid.version);
+        }
+
+        PID add(uint32_t pos)
+        {
+            // Find a page with free slots, or add a new page
+            uint32_t pageNum = u32Max;
+            while (!freePages.empty() && pageNum == u32Max)
+            {
+                auto& page = pages[freePages.back()];
+                if (!page.entries || page.head != u32Max)
+                    pageNum = freePages.back();
+                else
+                {
+                    page.inFreeList = false;
+                    freePages.pop_back();
+                }
+            }
+            if (pageNum == u32Max)
+            {
+                pageNum = pages.size();
+                pages.emplace_back();
+                pages.back().inFreeList = true;
+                freePages.push_back(pageNum);
+            }
+
+            auto& page = pages[pageNum];
+            if (!page.entries)
+                allocate(page);
+
+            // Pop the first slot off of the page's free list
+            uint32_t local = page.head;
+            auto& idx = page.entries[local];
+            idx.setUsed(true);
+            page.head = idx.index;
+            idx.index = pos;
+            ++page.used;
+
+            // Full pages don't need to be in the stack
+            if (page.head == u32Max)
+            {
+                page.inFreeList = false;
+                freePages.pop_back();
+            }
+
+            return PID{idx.version, static_cast<uint32_t>(pageNum * PageSize + local)};
+        }
+
+        void remove(uint32_t slot)
+        {
+            uint32_t pageNum = slot / PageSize;
+            uint32_t local = slot & (PageSize - 1);
+            auto& page = pages[pageNum];
+
+            // Increment version, mark as unused, and add to page's free list
+            auto& idx = page.entries[local];
+            idx.incVersion();
+            idx.setUsed(false);
+            idx.index = page.head;
+            page.head = local;
+            --page.used;
+
+            if (!page.inFreeList)
+            {
+                page.inFreeList = true;
+                freePages.push_back(pageNum);
+            }
+
+            // Free the page if nothing uses it anymore
+            if (!page.used)
+                release(page);
+        }
+
+        void clear()
+        {
+            pages.clear();
+            freePages.clear();
+        }
+
+        void reserve(size_t capacity)
+        {
+            pages.reserve((capacity + PageSize - 1) / PageSize);
+        }
+
+        size_t slots() const
+        {
+            return pages.size() * PageSize;
+        }
+
+        PID entry(uint32_t slot) const
+        {
+            auto& page = pages[slot / PageSize];
+            if (page.entries)
+                return page.entries[slot & (PageSize - 1)];
+            return PID{PID::unusedBit, u32Max};
+        }
+
+        template <typename Func>
+        void forEachUsed(Func func) const
+        {
+            uint32_t pageNum = 0;
+            for (const auto& page: pages)
+            {
+                if (page.used)
+                {
+                    for (uint32_t i = 0; i < PageSize; ++i)
+                    {
+                        const auto& pid = page.entries[i];
+                        if (pid.used())
+                            func(PID{pid.version, static_cast<uint32_t>(pageNum * PageSize + i)});
+                    }
+                }
+                ++pageNum;
+            }
+        }
+
+        // Returns the number of pages currently allocated
+        size_t allocatedPages() const
+        {
+            size_t total = 0;
+            for (const auto& page: pages)
+                total += (page.entries != nullptr);
+            return total;
+        }
+
+    private:
+
+        // Frees the entries of a page with the memory resource they came from
+        struct EntriesDeleter
+        {
+            std::pmr::memory_resource* resource;
+
+            void operator()(PID* entries) const
+            {
+                resource->deallocate(entries, sizeof(PID) * PageSize, alignof(PID));
+            }
+        };
+
+        using Entries = std::unique_ptr<PID[], EntriesDeleter>;
+
+        struct Page
+        {
+            Entries entries;
+
+            // Position of first free slot in this page
+            uint32_t head {u32Max};
+
+            // Number of used slots
+            uint32_t used {0};
+
+            // Starting version of all slots when the page is allocated
+            uint32_t minVersion {1};
+
+            bool inFreeList {false};
+        };
+
+        void allocate(Page& page)
+        {
+            // Link all of the slots together into the page's free list
+            page.entries = (spare ? std::move(spare) : allocateEntries());
+            for (uint32_t i = 0; i < PageSize; ++i)
+                new (&page.entries[i]) PID{page.minVersion | PID::unusedBit, i + 1};
+            page.entries[PageSize - 1].index = u32Max;
+            page.head = 0;
+        }
+
+        void release(Page& page)
+        {
+            // The next versions must be newer than any ID given out from this page
+            uint32_t maxVersion = page.minVersion;
+            for (uint32_t i = 0; i < PageSize; ++i)
+            {
+                uint32_t version = page.entries[i].version & PID::versionMask;
+                if (version > maxVersion)
+                    maxVersion = version;
+            }
+            PID next{maxVersion, 0};
+            next.incVersion();
+            page.minVersion = next.version;
+            if (!spare)
+                spare = std::move(page.entries);
+            page.entries.reset();
+            page.head = u32Max;
+        }
+
+        Entries allocateEntries()
+        {
+            void* entries = resource->allocate(sizeof(PID) * PageSize, alignof(PID));
+            return Entries(static_cast<PID*>(entries), EntriesDeleter{resource});
+        }
+
+        void copyPages(const PagedIndex& other)
+        {
+            pages.clear();
+            pages.resize(other.pages.size());
+            for (size_t i = 0; i < pages.size(); ++i)
+            {
+                const auto& src = other.pages[i];
+                auto& dest = pages[i];
+                dest.head = src.head;
+                dest.used = src.used;
+                dest.minVersion = src.minVersion;
+                dest.inFreeList = src.inFreeList;
+                if (src.entries)
+                {
+                    dest.entries = allocateEntries();
+                    std::uninitialized_copy(src.entries.get(), src.entries.get() + PageSize, dest.entries.get());
+                }
+            }
+        }
+
+        std::pmr::vector<Page> pages;
+
+        // Stack of pages with free slots (including pages that aren't allocated)
+        std::pmr::vector<uint32_t> freePages;
+
+        // Memory of the last freed page, reused by the next allocated page
+        Entries spare;
+
+        std::pmr::memory_resource* resource {std::pmr::get_default_resource()};
+};
+
+}
+
+#endif
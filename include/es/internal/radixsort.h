@@ -0,0 +1,115 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_RADIXSORT_H
+#define ES_RADIXSORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+
+namespace es
+{
+
+// True for key types that can be radix sorted
+template <typename Key>
+struct IsRadixKey
+{
+    static const bool value = ((std::is_integral<Key>::value && !std::is_same<Key, bool>::value) ||
+        std::is_same<Key, float>::value || std::is_same<Key, double>::value);
+};
+
+// Unsigned integers keep their order
+template <typename Key>
+typename std::enable_if<std::is_integral<Key>::value && std::is_unsigned<Key>::value, Key>::type
+toRadixKey(Key key)
+{
+    return key;
+}
+
+// Signed integers are ordered correctly by flipping the sign bit
+template <typename Key>
+typename std::enable_if<std::is_integral<Key>::value && std::is_signed<Key>::value, typename std::make_unsigned<Key>::type>::type
+toRadixKey(Key key)
+{
+    using UKey = typename std::make_unsigned<Key>::type;
+    return static_cast<UKey>(key) ^ (UKey(1) << (sizeof(Key) * 8 - 1));
+}
+
+// Floats are ordered correctly by flipping all bits of negative values,
+// and only the sign bit of positive values
+inline uint32_t toRadixKey(float key)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+inline uint64_t toRadixKey(double key)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+}
+
+/*
+Returns the positions of the keys in sorted order (stable).
+Uses an LSD radix sort with 8-bit digits, skipping digits that are the same for all keys.
+The histograms of all digits are built in a single pass.
+*/
+template <typename Key>
+std::vector<uint32_t> radixSortOrder(const std::vector<Key>& keys)
+{
+    using UKey = decltype(toRadixKey(Key{}));
+    const size_t count = keys.size();
+    const size_t digits = sizeof(UKey);
+
+    std::vector<UKey> radixKeys(count);
+    std::vector<uint32_t> order(count);
+    std::vector<size_t> counts(digits * 256);
+    for (size_t i = 0; i < count; ++i)
+    {
+        UKey key = toRadixKey(keys[i]);
+        radixKeys[i] = key;
+        order[i] = static_cast<uint32_t>(i);
+        for (size_t digit = 0; digit < digits; ++digit)
+            ++counts[digit * 256 + ((key >> (digit * 8)) & 0xFF)];
+    }
+
+    std::vector<UKey> tmpKeys(count);
+    std::vector<uint32_t> tmpOrder(count);
+    for (size_t digit = 0; digit < digits; ++digit)
+    {
+        size_t* digitCounts = &counts[digit * 256];
+
+        // Every key has the same digit, so this pass wouldn't change anything
+        if (std::find(digitCounts, digitCounts + 256, count) != digitCounts + 256)
+            continue;
+
+        // Convert the counts to starting positions
+        size_t total = 0;
+        for (size_t i = 0; i < 256; ++i)
+        {
+            size_t digitCount = digitCounts[i];
+            digitCounts[i] = total;
+            total += digitCount;
+        }
+
+        size_t shift = digit * 8;
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t dest = digitCounts[(radixKeys[i] >> shift) & 0xFF]++;
+            tmpKeys[dest] = radixKeys[i];
+            tmpOrder[dest] = order[i];
+        }
+        radixKeys.swap(tmpKeys);
+        order.swap(tmpOrder);
+    }
+    return order;
+}
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_RESERVEDARRAY_H
+#define ES_RESERVEDARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <memory_resource>
+
+namespace es
+{
+
+// Thin wrappers around the OS virtual memory functions
+// Note: They are defined in reservedarray.cpp, so the OS headers stay out of this one
+namespace vmem
+{
+
+// Returns the granularity that reserved ranges are rounded up to
+size_t pageSize();
+
+// Reserves address space without using any physical memory
+void* reserve(size_t bytes);
+
+// Makes part of a reserved range usable
+bool commit(void* ptr, size_t bytes);
+
+// Releases a whole reserved range
+void release(void* ptr, size_t bytes);
+
+}
+
+/*
+A vector-like container backed by a reserved range of virtual memory.
+    The full range for MaxElements is reserved up front, and pages are
+        committed as the array grows.
+    Growing never copies or moves elements, and never needs twice the memory.
+    The elements are always one contiguous span.
+    Throws std::bad_alloc when growing past MaxElements.
+*/
+template <class T, size_t MaxElements>
+class ReservedArray
+{
+    public:
+
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        ReservedArray() {}
+
+        // Reserved arrays get their memory straight from the OS,
+        // so the memory resource is ignored
+        explicit ReservedArray(std::pmr::memory_resource*) {}
+
+        ReservedArray(const ReservedArray& other)
+        {
+            reserve(other.count);
+            for (size_t i = 0; i < other.count; ++i)
+                emplace_back(other[i]);
+        }
+
+        ReservedArray(ReservedArray&& other):
+            base(other.base),
+            count(other.count),
+            committed(other.committed)
+        {
+            other.base = nullptr;
+            other.count = 0;
+            other.committed = 0;
+        }
+
+        ReservedArray& operator=(const ReservedArray& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other.count);
+                for (size_t i = 0; i < other.count; ++i)
+                    emplace_back(other[i]);
+            }
+            return *this;
+        }
+
+        ReservedArray& operator=(ReservedArray&& other)
+        {
+            if (this != &other)
+            {
+                freeRange();
+                std::swap(base, other.base);
+                std::swap(count, other.count);
+                std::swap(committed, other.committed);
+            }
+            return *this;
+        }
+
+        ~ReservedArray()
+        {
+            freeRange();
+        }
+
+        // Constructs a new element at the end
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (count == committed)
+                reserve(count + 1);
+            T* ptr = new (base + count) T(std::forward<Args>(args)...);
+            ++count;
+            return *ptr;
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        void pop_back()
+        {
+            --count;
+            base[count].~T();
+        }
+
+        T& back() { return base[count - 1]; }
+        const T& back() const { return base[count - 1]; }
+
+        T& operator[] (size_t pos) { return base[pos]; }
+        const T& operator[] (size_t pos) const { return base[pos]; }
+
+        std::pmr::polymorphic_allocator<T> get_allocator() const
+        {
+            return {};
+        }
+
+        // Destroys all elements (committed pages stay committed)
+        void clear()
+        {
+            while (count)
+                pop_back();
+        }
+
+        // Commits enough pages to hold the specified number of elements
+        void reserve(size_t capacity)
+        {
+            if (capacity <= committed)
+                return;
+            if (capacity > MaxElements)
+                throw std::bad_alloc();
+            if (!base)
+            {
+                base = static_cast<T*>(vmem::reserve(reservedBytes()));
+                if (!base)
+                    throw std::bad_alloc();
+            }
+
+            // Commit at least 64 pages at a time to reduce the number of system calls
+            size_t page = vmem::pageSize();
+            size_t oldBytes = roundUp(committed * sizeof(T), page);
+            size_t newBytes = roundUp(capacity * sizeof(T), page);
+            if (newBytes - oldBytes < page * 64)
+                newBytes = oldBytes + page * 64;
+            if (newBytes > reservedBytes())
+                newBytes = reservedBytes();
+            if (!vmem::commit(reinterpret_cast<char*>(base) + oldBytes, newBytes - oldBytes))
+                throw std::bad_alloc();
+            committed = newBytes / sizeof(T);
+            if (committed > MaxElements)
+                committed = MaxElements;
+        }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return committed; }
+        bool empty() const { return count == 0; }
+
+        T* data() { return base; }
+        const T* data() const { return base; }
+
+        iterator begin() { return base; }
+        iterator end() { return base + count; }
+        const_iterator begin() const { return base; }
+        const_iterator end() const { return base + count; }
+        const_iterator cbegin() const { return base; }
+        const_iterator cend() const { return base + count; }
+
+    private:
+
+        static size_t roundUp(size_t bytes, size_t page)
+        {
+            return (bytes + page - 1) / page * page;
+        }
+
+        static size_t reservedBytes()
+        {
+            return roundUp(MaxElements * sizeof(T), vmem::pageSize());
+        }
+
+        void freeRange()
+        {
+            clear();
+            if (base)
+                vmem::release(base, reservedBytes());
+            base = nullptr;
+            committed = 0;
+        }
+
+        T* base {nullptr};
+        size_t count {0};
+        size_t committed {0};
+};
+
+}
+
+#endif
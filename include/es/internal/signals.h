@@ -0,0 +1,93 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_SIGNALS_H
+#define ES_SIGNALS_H
+
+#include <vector>
+#include <algorithm>
+
+namespace es
+{
+
+struct Core;
+class Component;
+
+// A function pointer, and the instance to call it with (nullptr for free functions)
+struct ComponentDelegate
+{
+    using Func = void (*)(void* instance, Core& core, Component& comp);
+
+    Func func;
+    void* instance;
+
+    bool operator==(const ComponentDelegate& other) const
+    {
+        return (func == other.func && instance == other.instance);
+    }
+};
+
+/*
+A list of delegates that are called with a component, in the order they were connected.
+Delegates are two pointers each, so calling them doesn't allocate or use std::function.
+*/
+class ComponentSignal
+{
+    public:
+
+        // Adds a delegate (does nothing if it is already connected)
+        void connect(ComponentDelegate delegate)
+        {
+            if (std::find(delegates.begin(), delegates.end(), delegate) == delegates.end())
+                delegates.push_back(delegate);
+        }
+
+        // Removes a delegate
+        void disconnect(ComponentDelegate delegate)
+        {
+            auto found = std::find(delegates.begin(), delegates.end(), delegate);
+            if (found != delegates.end())
+                delegates.erase(found);
+        }
+
+        // Calls every delegate
+        // Note: Uses positions, so delegates can connect and disconnect others
+        void operator()(Core& core, Component& comp) const
+        {
+            for (size_t i = 0; i < delegates.size(); ++i)
+            {
+                auto delegate = delegates[i];
+                delegate.func(delegate.instance, core, comp);
+            }
+        }
+
+        size_t size() const
+        {
+            return delegates.size();
+        }
+
+        bool empty() const
+        {
+            return delegates.empty();
+        }
+
+    private:
+        std::vector<ComponentDelegate> delegates;
+};
+
+// The lifecycle signals of a component type
+struct ComponentSignals
+{
+    // After a component is added to an entity
+    ComponentSignal construct;
+
+    // After a component is assigned or replaced
+    ComponentSignal update;
+
+    // Before a component is removed from an entity
+    ComponentSignal destroy;
+};
+
+}
+
+#endif
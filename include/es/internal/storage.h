@@ -0,0 +1,73 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_STORAGE_H
+#define ES_STORAGE_H
+
+#include <vector>
+#include <memory_resource>
+#include <es/internal/chunkedarray.h>
+#include <es/internal/reservedarray.h>
+
+namespace es
+{
+
+/*
+Storage policies for PackedArray.
+A policy provides the vector-like container used for the elements, the index,
+    and the reverse lookup table.
+Each container can be constructed from a std::pmr::memory_resource to allocate from,
+    and get_allocator().resource() returns it.
+*/
+
+// Default policy: one contiguous std::pmr::vector per array
+// Growing reallocates and moves every element
+struct VectorStorage
+{
+    template <class A>
+    using Array = std::pmr::vector<A>;
+};
+
+// Fixed-size chunks that are never moved once allocated
+// Element addresses stay valid until an element is erased
+template <size_t ChunkSize = 1024>
+struct ChunkedStorage
+{
+    template <class A>
+    using Array = ChunkedArray<A, ChunkSize>;
+};
+
+// One contiguous range of reserved virtual memory, with pages committed on demand
+// Growing never copies, but the array can't hold more than MaxElements
+template <size_t MaxElements = (1 << 24)>
+struct ReservedStorage
+{
+    template <class A>
+    using Array = ReservedArray<A, MaxElements>;
+};
+
+// Calls func(data, count) for each contiguous block of elements
+template <class A, class Alloc, typename Func>
+void forEachBlock(std::vector<A, Alloc>& array, Func func)
+{
+    if (!array.empty())
+        func(array.data(), array.size());
+}
+
+template <class A, size_t MaxElements, typename Func>
+void forEachBlock(ReservedArray<A, MaxElements>& array, Func func)
+{
+    if (!array.empty())
+        func(array.data(), array.size());
+}
+
+template <class A, size_t ChunkSize, typename Func>
+void forEachBlock(ChunkedArray<A, ChunkSize>& array, Func func)
+{
+    for (size_t i = 0; i < array.chunkCount(); ++i)
+        func(array.chunkData(i), array.chunkSize(i));
+}
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_TIMINGWHEEL_H
+#define ES_TIMINGWHEEL_H
+
+#include <cstdint>
+#include <vector>
+#include <es/internal/id.h>
+#include <es/internal/packedarray.h>
+
+namespace es
+{
+
+// Something that timers can fire, such as an event channel
+class TimerTarget
+{
+    public:
+        virtual ~TimerTarget() {}
+
+        // Called when a timer expires, with the value it was scheduled with
+        virtual void expire(ID value) = 0;
+
+        // Called when a timer is cancelled before it expires
+        virtual void cancel(ID value) = 0;
+};
+
+/*
+Timers that expire after a number of ticks, stored in a hierarchical timing wheel.
+    Level 0 has a slot for each of the next 64 ticks, level 1 has a slot for each
+        of the next 64 * 64 ticks, and so on, so every 64-bit deadline fits.
+    When the ticks reach the start of a higher level slot, its timers are moved
+        down into the lower levels, closer to where they expire. Each timer moves
+        at most once per level, so scheduling, cancelling and expiring are O(1)
+        amortized, no matter how many timers there are.
+    Timers that expire on the same tick expire in the order they were scheduled.
+    Not thread safe.
+*/
+class TimingWheel
+{
+    public:
+
+        TimingWheel();
+
+        // Schedules a timer that calls target.expire(value) after a number of ticks
+        // Returns the ID of the timer, which can be used to cancel it
+        // Note: The target must outlive the timer, and ticks must be at least 1
+        ID schedule(uint64_t ticks, TimerTarget& target, ID value);
+
+        // Cancels a timer, and calls target.cancel(value)
+        // Returns false if the timer already expired or was cancelled
+        bool cancel(ID timerId);
+
+        // Cancels all timers of a target
+        void cancelAll(TimerTarget& target);
+
+        // Returns true if the timer hasn't expired or been cancelled yet
+        bool isPending(ID timerId) const;
+
+        // Moves forward a number of ticks, expiring timers in order of their deadlines
+        void advance(uint64_t ticks = 1);
+
+        // Returns the number of ticks advanced so far
+        uint64_t getTick() const;
+
+        // Returns the number of pending timers
+        size_t size() const;
+
+        // Cancels all timers
+        void clear();
+
+    private:
+
+        struct Timer
+        {
+            TimerTarget* target;
+            ID value;
+            uint64_t deadline;
+        };
+
+        static const unsigned slotBits = 6;
+        static const unsigned slotCount = 1 << slotBits;
+        static const unsigned levelCount = (64 + slotBits - 1) / slotBits;
+
+        using Slot = std::vector<ID>;
+
+        // Puts a timer in the slot of the lowest level that its deadline fits in
+        void insert(ID timerId, uint64_t deadline);
+
+        // Moves the timers of a higher level slot into the lower levels
+        void cascade(unsigned level);
+
+        // Moves forward one tick
+        void step();
+
+        Slot& getSlot(unsigned level, uint64_t deadline);
+
+        // Timers are looked up by ID, so cancelled timers can stay in their slots
+            // and are skipped when they are reached
+        PackedArray<Timer> timers;
+
+        // All slots of all levels (only allocated when the first timer is scheduled)
+        std::vector<Slot> slots;
+
+        // Timers being processed (kept to reuse the memory)
+        Slot pending;
+
+        uint64_t tick {0};
+};
+
+}
+
+#endif
@@ -4,7 +4,13 @@
 #ifndef ES_SYSTEM_H
 #define ES_SYSTEM_H
 
+#include <chrono>
+#include <cassert>
+#include <vector>
+#include <limits>
+#include <algorithm>
 #include <es/world.h>
+#include <es/coroutine.h>
 
 namespace es
 {
@@ -17,20 +23,229 @@ class System
 {
     public:
         System() {}
-        virtual ~System() {}
+
+        // Cancels the tasks the system started that are still running
+        virtual ~System()
+        {
+            if (scheduler)
+            {
+                for (ID taskId: tasks)
+                    scheduler->cancel(taskId);
+            }
+        }
 
         void setWorld(World* w)
         {
             world = w;
         }
 
+        void setScheduler(Scheduler* s)
+        {
+            scheduler = s;
+        }
+
         virtual void initialize() {}
 
         // Derived classes must implement this function
         virtual void update(float dt) = 0;
 
+        using Clock = std::chrono::steady_clock;
+
+        // Sets when the current update should stop (used by SystemContainer for time budgets)
+        void setDeadline(Clock::time_point newDeadline)
+        {
+            deadline = newDeadline;
+        }
+
+        // Returns true if the system can keep working in this update
+        // Systems with a time budget should check this as they work, and when it returns
+            // false, stop and continue where they left off in the next update
+        // Always returns true for systems without a time budget
+        bool hasTime() const
+        {
+            return (deadline == Clock::time_point::max() || Clock::now() < deadline);
+        }
+
+        // Returns true if SystemContainer::updateAll() should update the system
+        // Systems without triggers are always updated, and systems with triggers are
+            // only updated when one of them changed since the last update,
+            // or when requestUpdate() was called
+        // A trigger that fired stays pending until the system is updated, so a system
+            // that isn't updated right away (such as with a fixed step) still sees it
+        bool checkTriggers()
+        {
+            if (componentTriggers.empty() && eventTriggers.empty())
+                return true;
+            if (!updatePending)
+                updatePending = hasChanges();
+            return updatePending;
+        }
+
+        // Clears the pending update (called before updating)
+        // The system can request another update during its update
+        void clearPendingUpdate()
+        {
+            updatePending = false;
+        }
+
+        // Remembers the current versions of the trigger components (called after updating)
+        // Changes the system made during its own update don't trigger it again
+        // Note: Only called when the system was actually updated, so a fixed step system
+            // that is waiting for its next step still sees the changes
+        void resetTriggers()
+        {
+            for (auto& trigger: componentTriggers)
+                trigger.version = trigger.getVersion(*world);
+            eventFrame = world->events().getFrame();
+        }
+
     protected:
+
+        // Makes updateAll() skip the system, unless there were tracked changes to components
+            // of these types since its last update (see World::getVersion()):
+            // Components that were added, removed, or moved (such as by sorting)
+            // Any change made through Entity (assign(), replace(), emplaceOrReplace(), patch())
+            // Changes counted with World::markChanged()
+        // Warning: Writes through references, handles and queries are NOT seen, such as
+            // e.at<Position>()->x += 1, unless the writer calls World::markChanged()
+        // Example: triggerOnTrackedChanges<Widget, Position>();
+        template <typename... Types>
+        void triggerOnTrackedChanges()
+        {
+            (componentTriggers.push_back({&getVersion<Types>}), ...);
+        }
+
+        // Makes updateAll() skip the system, unless events of these types were sent
+            // during the last frame (see EventChannel::getPrevious())
+        // Each event triggers one update, in the frame after it was sent
+        template <typename... Types>
+        void triggerOnEvents()
+        {
+            (eventTriggers.push_back(&hasEvents<Types>), ...);
+        }
+
+        // Makes the next updateAll() update the system, even if its triggers didn't change
+        // Useful for systems that didn't finish their work, such as with a time budget
+        void requestUpdate()
+        {
+            updatePending = true;
+        }
+
+        // Starts a coroutine on the scheduler of the system container (see Task)
+        // Returns the ID of the task, which can be cancelled with scheduler->cancel()
+        // Tasks that are still running when the system is destroyed are cancelled
+        ID start(Task task)
+        {
+            assert(scheduler);
+
+            // Forget the tasks that finished, so the list doesn't grow
+            tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [this](ID taskId) {
+                return !scheduler->isRunning(taskId);
+            }), tasks.end());
+
+            ID taskId = scheduler->start(std::move(task));
+            if (scheduler->isRunning(taskId))
+                tasks.push_back(taskId);
+            return taskId;
+        }
+
         World* world{nullptr};
+        Scheduler* scheduler{nullptr};
+
+    private:
+
+        // Returns true if a trigger changed since the last update
+        bool hasChanges() const
+        {
+            for (auto& trigger: componentTriggers)
+            {
+                if (trigger.getVersion(*world) != trigger.version)
+                    return true;
+            }
+            if (world->events().getFrame() != eventFrame)
+            {
+                for (auto hasEvents: eventTriggers)
+                {
+                    if (hasEvents(*world))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        template <typename T>
+        static uint64_t getVersion(const World& w)
+        {
+            return w.getVersion<T>();
+        }
+
+        template <typename T>
+        static bool hasEvents(World& w)
+        {
+            return !w.events().channel<T>().getPrevious().empty();
+        }
+
+        struct ComponentTrigger
+        {
+            uint64_t (*getVersion)(const World&);
+
+            // The version at the last update (a new trigger always updates once)
+            uint64_t version{std::numeric_limits<uint64_t>::max()};
+        };
+
+        std::vector<ComponentTrigger> componentTriggers;
+        std::vector<bool (*)(World&)> eventTriggers;
+        // Set by requestUpdate(), or by a trigger that fired before the system was updated
+        bool updatePending{false};
+
+        // The tasks started by start(), which are cancelled by the destructor
+        std::vector<ID> tasks;
+
+        // The event frame of the last update, so events don't trigger it twice
+        uint64_t eventFrame{std::numeric_limits<uint64_t>::max()};
+
+        Clock::time_point deadline{Clock::time_point::max()};
+};
+
+/*
+A system whose update is a coroutine, which can suspend across frames.
+    run() is started when the system is updated, and is resumed by the system container
+        until it returns. Then it is started again in the next update.
+    This keeps work that takes many frames, such as staged spawning, in one function:
+        es::Task run()
+        {
+            for (auto& wave: waves)
+            {
+                for (auto& spawn: wave)
+                {
+                    world->copy(spawn);
+                    co_await es::nextFrame();
+                }
+                co_await es::seconds(5.0f);
+            }
+        }
+*/
+class CoroutineSystem: public System
+{
+    public:
+        // Derived classes must implement this function instead of update()
+        virtual Task run() = 0;
+
+        // Starts run(), unless it is still running
+        void update(float)
+        {
+            if (!scheduler->isRunning(task))
+                task = start(run());
+        }
+
+        // Returns true if run() was started, and hasn't returned yet
+        bool isRunning() const
+        {
+            return (scheduler && scheduler->isRunning(task));
+        }
+
+    private:
+        ID task{invalidId};
 };
 
 }
@@ -18,6 +18,62 @@ namespace es
 
 class World;
 
+/*
+Controls how often SystemContainer::updateAll() updates a system, and for how long.
+    interval: The system is only updated every N frames (1 = every frame).
+        The frames systems land on are spread out, so systems with the same interval
+        don't all run on the same frame (unless a phase is set).
+    step: The system is updated with this dt, as many times as fit in the elapsed
+        time (0 = once, with the elapsed time). The time that's left over is kept for
+        the next frame. If more than maxSteps would be needed, the extra time is dropped,
+        so a slow frame doesn't make the next one even slower.
+    budget: The number of seconds the system has for each update (0 = unlimited).
+        The system checks hasTime() as it works, and stops when the time runs out.
+Examples:
+    UpdatePolicy::fixedStep(1.0f / 60.0f) // Physics at 60 Hz, no matter the frame rate
+    UpdatePolicy::fixedStep(0.1f, 1) // AI at 10 Hz
+    UpdatePolicy::everyNFrames(4) // Every 4th frame, with 4 frames worth of dt
+    UpdatePolicy::timeBudget(0.002f) // 2 ms per frame
+*/
+struct UpdatePolicy
+{
+    static const unsigned autoPhase = static_cast<unsigned>(-1);
+
+    unsigned interval{1};
+    unsigned phase{autoPhase};
+    float step{0.0f};
+    unsigned maxSteps{5};
+    float budget{0.0f};
+
+    static UpdatePolicy everyFrame()
+    {
+        return UpdatePolicy();
+    }
+
+    static UpdatePolicy fixedStep(float step, unsigned maxSteps = 5)
+    {
+        UpdatePolicy policy;
+        policy.step = step;
+        policy.maxSteps = maxSteps;
+        return policy;
+    }
+
+    static UpdatePolicy everyNFrames(unsigned interval, unsigned phase = autoPhase)
+    {
+        UpdatePolicy policy;
+        policy.interval = interval;
+        policy.phase = phase;
+        return policy;
+    }
+
+    static UpdatePolicy timeBudget(float seconds)
+    {
+        UpdatePolicy policy;
+        policy.budget = seconds;
+        return policy;
+    }
+};
+
 /*
 This class can contain different systems, which are derived from the System base class.
 It updates the systems in the order they were added, but also supports updating a single system by type.
@@ -33,6 +89,15 @@ Example usage:
 
     // Also supports updating single systems by type:
     systems.update<RenderSystem>(dt);
+
+    // Systems can be updated less often, or be given a time budget
+    systems.setPolicy<AISystem>(UpdatePolicy::fixedStep(0.1f, 1));
+
+    // Systems that call System::triggerOnTrackedChanges() or triggerOnEvents() are skipped while their
+        // inputs don't change, and get the time since their last update as dt
+
+    // Coroutines started by systems (see Task and CoroutineSystem) are resumed
+        // at the start of updateAll(), before the systems are updated
 */
 class SystemContainer
 {
@@ -57,19 +122,36 @@ class SystemContainer
         template <typename T>
         void initialize();
 
-        // Calls update() on all systems
+        // Resumes the coroutines that are done waiting, then calls update() on all systems,
+            // depending on their update policies and triggers
         // Note: The order this is called is the same order the systems were added
         void updateAll(float dt);
 
-        // Updates a specific system
+        // Updates a specific system (right away, without its update policy)
         template <typename T>
         void update(float dt);
 
+        // Sets how often updateAll() updates a system, and for how long (see UpdatePolicy)
+        // Systems with an interval and no phase get the phase that the fewest other
+            // systems are updated on
+        template <typename T>
+        void setPolicy(const UpdatePolicy& policy);
+
+        // Returns the update policy of a system (nullptr if it doesn't exist)
+        template <typename T>
+        const UpdatePolicy* getPolicy() const;
+
+        // Returns the number of times updateAll() was called
+        uint64_t getFrame() const;
+
+        // Returns the scheduler that runs the coroutines of the systems
+        Scheduler& getScheduler();
+
         // Removes a specific system
         template <typename T>
         void remove();
 
-        // Removes all systems
+        // Removes all systems (and their coroutines)
         void clear();
 
         // Swaps the order of two systems by type
@@ -100,6 +182,9 @@ class SystemContainer
 
         World* world{nullptr};
 
+        // Declared before the systems, so systems can cancel their coroutines when destroyed
+        Scheduler scheduler;
+
         struct SystemPtr
         {
             SystemPtr() {}
@@ -109,14 +194,28 @@ class SystemContainer
             {}
             std::unique_ptr<System> ptr;
             std::type_index typeIndex{typeid(void)};
+            UpdatePolicy policy{UpdatePolicy::everyNFrames(1, 0)};
+
+            // Time since the last update (or left over from the last fixed step)
+            float elapsed{0.0f};
         };
 
         std::vector<SystemPtr> systems;
         std::unordered_map<std::type_index, size_t> systemTypes;
 
+        uint64_t frame{0};
+
         // Returns the position of a system by type index
         size_t getIndex(const std::type_index& type) const;
 
+        void setPolicy(size_t index, const UpdatePolicy& policy);
+
+        // Returns the phase that the fewest systems with intervals are updated on
+        unsigned pickPhase(size_t index, unsigned interval) const;
+
+        // Updates a system if its policy says it should be updated this frame
+        void updateSystem(SystemPtr& system, float dt);
+
         // Rebuilds the system types index (default will rebuild all)
         void updateSystemTypes(size_t start = 0);
 };
@@ -132,6 +231,7 @@ size_t SystemContainer::add(Args&&... args)
         index = systems.size();
         auto sys = std::make_unique<T>(std::forward<Args>(args)...);
         sys->setWorld(world);
+        sys->setScheduler(&scheduler);
         systems.emplace_back(std::move(sys), typeIndex);
         systemTypes[typeIndex] = index;
     }
@@ -157,6 +257,23 @@ void SystemContainer::update(float dt)
         sys->update(dt);
 }
 
+template <typename T>
+void SystemContainer::setPolicy(const UpdatePolicy& policy)
+{
+    size_t index = getIndex<T>();
+    if (index != invalidIndex)
+        setPolicy(index, policy);
+}
+
+template <typename T>
+const UpdatePolicy* SystemContainer::getPolicy() const
+{
+    size_t index = getIndex<T>();
+    if (index != invalidIndex)
+        return &systems[index].policy;
+    return nullptr;
+}
+
 template <typename T>
 void SystemContainer::remove()
 {
@@ -186,9 +303,7 @@ void SystemContainer::move(size_t destIndex)
     if (index != invalidIndex)
     {
         // Move out pointer and type
-        SystemPtr systemPointer;
-        systemPointer.ptr = std::move(systems[index].ptr);
-        systemPointer.typeIndex = systems[index].typeIndex;
+        SystemPtr systemPointer = std::move(systems[index]);
 
         // Erase original pointer location
         systems.erase(systems.begin() + index);
@@ -0,0 +1,167 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#ifndef ES_TARGETEDCHANNEL_H
+#define ES_TARGETEDCHANNEL_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <es/internal/id.h>
+#include <es/internal/radixsort.h>
+#include <es/eventstream.h>
+
+namespace es
+{
+
+/*
+Events of a single type that are sent to a specific entity, such as damage.
+    Events are sent in any order during a frame. When the bus moves to the next frame,
+        they are sorted by their target (keeping the order for each target), so the
+        events of an entity are next to each other, and found with a binary search.
+    Each event can be received by its target for one frame, starting the frame after
+        it was sent. A system that goes through entities only looks at their own events,
+        instead of every event of the type.
+Example:
+    channel.send(ent.getId(), Damage(5));
+    // Next frame
+    for (auto& damage: channel.get(ent.getId()))
+        health -= damage.amount;
+*/
+template <class T>
+class TargetedChannel: public BaseEventChannel
+{
+    public:
+
+        using iterator = typename std::vector<T>::iterator;
+
+        // The events of one target
+        class Range
+        {
+            public:
+                Range(iterator first, iterator last): first(first), last(last) {}
+
+                iterator begin() const { return first; }
+                iterator end() const { return last; }
+                size_t size() const { return last - first; }
+                bool empty() const { return first == last; }
+
+            private:
+                iterator first;
+                iterator last;
+        };
+
+        explicit TargetedChannel(const uint64_t& busFrame): frame(busFrame), busFrame(&busFrame) {}
+
+        // Sends an event to an entity
+        void send(ID target, const T& event)
+        {
+            update();
+            targets.push_back(target);
+            events.push_back(event);
+        }
+
+        // Sends an event to an entity (forwards arguments)
+        template <class... Args>
+        void send(ID target, Args&&... args)
+        {
+            update();
+            targets.push_back(target);
+            events.emplace_back(std::forward<Args>(args)...);
+        }
+
+        // Returns the events sent to an entity during the last frame
+        Range get(ID target)
+        {
+            update();
+            auto found = std::equal_range(sortedTargets.begin(), sortedTargets.end(), target);
+            return {sortedEvents.begin() + (found.first - sortedTargets.begin()),
+                sortedEvents.begin() + (found.second - sortedTargets.begin())};
+        }
+
+        // Returns all events sent during the last frame, sorted by target
+        const std::vector<T>& getPrevious()
+        {
+            update();
+            return sortedEvents;
+        }
+
+        // Returns the targets of getPrevious() (in the same order)
+        const std::vector<ID>& getPreviousTargets()
+        {
+            update();
+            return sortedTargets;
+        }
+
+        // Returns the number of events from this frame and the last frame
+        size_t size() const
+        {
+            if (frame == *busFrame)
+                return sortedEvents.size() + events.size();
+            if (frame + 1 == *busFrame)
+                return events.size();
+            return 0;
+        }
+
+        bool empty() const
+        {
+            return (size() == 0);
+        }
+
+        // Removes the events from this frame and the last frame
+        void clear()
+        {
+            targets.clear();
+            events.clear();
+            sortedTargets.clear();
+            sortedEvents.clear();
+            frame = *busFrame;
+        }
+
+        // Targeted events are only sent from one thread, so there is nothing to merge
+        void merge() {}
+
+    private:
+
+        // Sorts this frame's events if the bus moved to the next frame
+        // Note: The vectors keep their memory, so a steady number of events doesn't allocate
+            // (other than the radix sort's buffers)
+        void update()
+        {
+            if (frame != *busFrame)
+            {
+                sortedTargets.clear();
+                sortedEvents.clear();
+                if (frame + 1 == *busFrame)
+                {
+                    // The sort is stable, so each target's events stay in the order they were sent
+                    for (uint32_t pos: radixSortOrder(targets))
+                    {
+                        sortedTargets.push_back(targets[pos]);
+                        sortedEvents.push_back(std::move(events[pos]));
+                    }
+                }
+                targets.clear();
+                events.clear();
+                frame = *busFrame;
+            }
+        }
+
+        // Events sent during this frame
+        std::vector<ID> targets;
+        std::vector<T> events;
+
+        // Events sent during the last frame, sorted by target
+        std::vector<ID> sortedTargets;
+        std::vector<T> sortedEvents;
+
+        // The frame of the events being sent
+        uint64_t frame;
+
+        const uint64_t* busFrame;
+};
+
+}
+
+#endif
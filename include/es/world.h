@@ -4,7 +4,14 @@
 #ifndef ES_WORLD_H
 #define ES_WORLD_H
 
+#include <map>
+#include <limits>
+#include <cstdint>
+#include <memory_resource>
 #include <es/internal/core.h>
+#include <es/internal/framearena.h>
+#include <es/internal/cursor.h>
+#include <es/events.h>
 #include <es/entity.h>
 
 namespace es
@@ -22,14 +29,95 @@ struct ComponentArrayIter
     auto cbegin() const { return array.cbegin(); }
     auto cend() const { return array.cend(); }
     size_t size() const { return array.size(); }
+    size_t slots() const { return array.slots(); }
+    T* atSlot(size_t slot) { return array.atSlot(slot); }
+
+    template <typename Func>
+    void forEachBlock(Func func) { array.forEachBlock(func); }
 
     private:
         ComponentArray<T>& array;
 };
 
+/*
+Connects functions to a lifecycle signal of a component type.
+The functions are called with the entity and its component:
+    void onPositionAdded(es::Entity& ent, Position& pos);
+    world.onConstruct<Position>().connect<&onPositionAdded>();
+Member functions also need the instance to call them with:
+    world.onDestroy<Position>().connect<&SpatialHash::onRemoved>(spatialHash);
+Note: The instance must stay alive until it is disconnected.
+*/
+template <class T>
+class SignalSink
+{
+    public:
+        explicit SignalSink(ComponentSignal& signal): signal(signal) {}
+
+        // Connects a free function
+        template <void (*Func)(Entity&, T&)>
+        void connect()
+        {
+            signal.connect({&call<Func>, nullptr});
+        }
+
+        // Connects a member function of an instance
+        template <auto Member, class Instance>
+        void connect(Instance& instance)
+        {
+            signal.connect({&callMember<Member, Instance>, &instance});
+        }
+
+        // Disconnects a free function
+        template <void (*Func)(Entity&, T&)>
+        void disconnect()
+        {
+            signal.disconnect({&call<Func>, nullptr});
+        }
+
+        // Disconnects a member function of an instance
+        template <auto Member, class Instance>
+        void disconnect(Instance& instance)
+        {
+            signal.disconnect({&callMember<Member, Instance>, &instance});
+        }
+
+        // Returns the number of connected functions
+        size_t size() const
+        {
+            return signal.size();
+        }
+
+        bool empty() const
+        {
+            return signal.empty();
+        }
+
+    private:
+
+        template <void (*Func)(Entity&, T&)>
+        static void call(void*, Core& core, Component& comp)
+        {
+            Entity ent(core, comp.getOwnerId());
+            Func(ent, static_cast<T&>(comp));
+        }
+
+        template <auto Member, class Instance>
+        static void callMember(void* instance, Core& core, Component& comp)
+        {
+            Entity ent(core, comp.getOwnerId());
+            (static_cast<Instance*>(instance)->*Member)(ent, static_cast<T&>(comp));
+        }
+
+        ComponentSignal& signal;
+};
+
 /*
 A wrapper class around Core and Entity.
 Creates instances of Entity by constructing it with ID and Core&.
+Worlds don't share any state that changes while they run, so different worlds
+    can be used from different threads without any synchronization.
+    A single world is not thread safe.
 */
 class World
 {
@@ -37,6 +125,11 @@ class World
 
         World() {}
 
+        // Allocates all entities and components from a memory resource,
+        // such as a std::pmr::monotonic_buffer_resource or unsynchronized_pool_resource
+        // Note: The resource must outlive the world
+        explicit World(std::pmr::memory_resource* resource);
+
 
         // Creating entities =================================================
 
@@ -44,12 +137,27 @@ class World
         Entity create(const std::string& name = "");
 
         // Creates an entity from a prototype (same as clone)
+        // Prototypes come from this world's prototype bank (see setPrototypes)
         Entity copy(const std::string& prototypeName, const std::string& name = "");
 
         // Creates an entity from a prototype (same as copy)
         Entity clone(const std::string& prototypeName, const std::string& name = "");
 
 
+        // Moving entities between worlds ===================================
+
+        // Moves an entity into another world, and returns it
+        // Components are moved instead of copied, and the entity is destroyed in this world
+        Entity migrate(ID id, World& destWorld);
+
+        // Moves all entities and components of another world into this one
+        // Each component array is appended in bulk, and the other world is left empty
+        // The destroys scheduled in the other world are cancelled
+        // Merging a world into itself does nothing
+        // Note: The entities get new IDs, and names should be unique across both worlds
+        void merge(World&& srcWorld);
+
+
         // Creates a new entity if needed ====================================
 
         // Get entity by name
@@ -82,9 +190,14 @@ class World
         // Remove an entity by name
         void destroy(const std::string& name);
 
-        // Removes all entities
+        // Removes all entities (and cancels the destroys scheduled with destroyAfter)
         void clear();
 
+        // Destroys an entity after a number of frames, when nextFrame() is called
+        // Returns the ID of the timer, which can be cancelled with events().cancelTimer()
+        // With 0 frames, the entity is destroyed right away, and invalidId is returned
+        ID destroyAfter(ID id, uint64_t frames);
+
 
         // Query entities and components =====================================
 
@@ -101,10 +214,119 @@ class World
         template <typename... Args>
         EntityList query(const std::string& name, Args&&... args);
 
+        // Same as the query functions above, but the lists are allocated from a
+        // memory resource, such as frameMemory()
+        using PmrEntityList = std::pmr::vector<Entity>;
+        PmrEntityList query(std::pmr::memory_resource* resource);
+
+        template <typename T, typename... Args>
+        PmrEntityList query(std::pmr::memory_resource* resource);
+
+        template <typename... Args>
+        PmrEntityList query(std::pmr::memory_resource* resource, const std::string& name, Args&&... args);
+
         // Used for iterating directly through components
         template <typename T>
         ComponentArrayIter<T> getComponents();
 
+        // Returns the version of a component type, which changes when its components are
+            // added, removed, or changed through Entity (assign(), replace(), patch(), etc.)
+        template <typename T>
+        uint64_t getVersion() const;
+
+        // Counts a change to components of a type that were changed through references,
+            // so systems triggered by the type are updated (see System::triggerOnTrackedChanges())
+        template <typename T>
+        void markChanged();
+
+
+        // Frame memory ======================================================
+
+        // Starts a new frame, which frees everything allocated from frameMemory()
+        // Events sent before the last frame are also dropped (see events())
+        void nextFrame();
+
+        // Returns the number of times nextFrame() was called
+        uint64_t getFrame() const;
+
+        // Returns an arena for temporaries that only need to last until nextFrame()
+        // Once the arena has grown enough for a frame, it stops allocating memory
+        std::pmr::memory_resource* frameMemory();
+
+
+        // Events and prototypes =============================================
+
+        // Returns the event channels of this world
+        // Events are kept for the frame they are sent in and the next one
+        EventBus& events();
+
+        // Uses the entities of another world as prototypes (default: World::prototypes)
+        // The bank is only read from, so many worlds on different threads can share one
+        // Note: The bank must outlive this world
+        void setPrototypes(World& bank);
+
+        // Returns the world that prototypes are copied from
+        World& getPrototypes();
+
+
+        // Component signals =================================================
+
+        // Note: These are called for every entity in this world, and cost nothing
+            // for component types that nothing is connected to.
+            // Changing a component through a reference or handle doesn't call
+            // onUpdate(), only assign(), replace(), emplaceOrReplace() and patch() do.
+            // Functions can read the world, but must not add or remove components
+            // of the type they were called for.
+
+        // Called after a component of a type is added to an entity
+            // (including by cloning, migrating and merging)
+        template <typename T>
+        SignalSink<T> onConstruct();
+
+        // Called after a component of a type is assigned or replaced
+        template <typename T>
+        SignalSink<T> onUpdate();
+
+        // Called before a component of a type is removed from an entity
+            // (including when the entity is destroyed, migrated, or the world is cleared)
+        template <typename T>
+        SignalSink<T> onDestroy();
+
+
+        // Memory layout =====================================================
+
+        // Sets how components of a type are erased
+        // Tombstones keep the order of the components until compact() is called
+        // Erased components are reset to a default constructed value right away, so
+            // their memory is freed, but their destructors only run at compact()
+        template <typename T>
+        void setEraseMode(EraseMode mode);
+
+        // Removes tombstones from all component arrays (call this at a sync point)
+        // Only arrays with more than maxRatio tombstones are compacted
+        void compact(float maxRatio = 0.0f, bool stable = true);
+
+        // Sorts the components of a type, without changing any IDs
+        template <typename T, typename Compare>
+        void sort(Compare compare);
+
+        // Sorts the components of a type by a key (integer/float keys are radix sorted)
+        template <typename T, typename KeyFunc>
+        void sortBy(KeyFunc keyFunc);
+
+        // Reorders the components of the other types, so that each entity's
+            // components are in the same relative order as in the driver array.
+        // Components whose entity doesn't have a driver component are moved to the end.
+        // Returns the number of components that changed position.
+        template <typename Driver, typename T, typename... Others>
+        size_t optimizeLayout();
+
+        // Incremental version of optimizeLayout(), which moves at most
+            // maxMoves components of each type.
+        // Each call continues where the last one stopped, so this can be called every frame.
+        template <typename Driver, typename T, typename... Others>
+        size_t optimizeLayout(size_t maxMoves);
+
 
         // Iterate through all entities ======================================
 
@@ -134,62 +356,106 @@ class World
 
     private:
 
+        using TypeList = std::pmr::vector<TypeIndex>;
+
         template <typename... Args>
-        std::vector<TypeIndex> getTypeIndexes() const;
+        TypeList getTypeIndexes(std::pmr::memory_resource* resource) const;
 
         template <typename... Args>
-        std::vector<TypeIndex> getTypeIndexesString(const std::string& name, Args&&... args) const;
+        TypeList getTypeIndexesString(std::pmr::memory_resource* resource, const std::string& name, Args&&... args) const;
 
-        void getTypeIndexString(std::vector<TypeIndex>& types, const std::string& name) const;
+        void getTypeIndexString(TypeList& types, const std::string& name) const;
 
         template <typename... Args>
-        void getTypeIndexString(std::vector<TypeIndex>& types, const std::string& name1, const std::string& name2, Args&&... args) const;
+        void getTypeIndexString(TypeList& types, const std::string& name1, const std::string& name2, Args&&... args) const;
 
         template <typename T>
-        void getTypeIndex(std::vector<TypeIndex>& types) const;
+        void getTypeIndex(TypeList& types) const;
 
         template <typename A, typename B, typename... Args>
-        void getTypeIndex(std::vector<TypeIndex>& types) const;
+        void getTypeIndex(TypeList& types) const;
+
+        // Adds the entities with all of the types to the list
+        template <typename List>
+        void queryTypes(TypeList& types, List& entities);
+
+        template <typename List>
+        void iterate(const std::type_index& minType, const TypeList& types, List& entities);
 
-        EntityList queryTypes(std::vector<TypeIndex>& types);
+        template <typename Driver, typename T>
+        size_t alignLayout(size_t maxMoves);
 
-        EntityList iterate(const std::type_index& minType, std::vector<TypeIndex>& types);
+        template <typename Driver, typename A, typename B, typename... Args>
+        size_t alignLayout(size_t maxMoves);
 
         Core core;
 
+        EventBus eventBus;
+
+        // Where copy() gets prototypes from
+        World* prototypeBank {&prototypes};
+
+        // Destroys entities when their timers expire (see destroyAfter())
+        class EntityDestroyer: public TimerTarget
+        {
+            public:
+                explicit EntityDestroyer(Core& core): core(core) {}
+                void expire(ID id);
+                void cancel(ID) {}
+
+            private:
+                Core& core;
+        };
+
+        EntityDestroyer destroyer {core};
+
+        // Temporary memory that is reset by nextFrame()
+        FrameArena frameArena;
+        uint64_t frame {0};
+
+        // Where each incremental optimizeLayout() left off
+        struct LayoutCursor
+        {
+            size_t driverPos {0};
+            uint32_t target {0};
+        };
+        std::map<std::pair<std::type_index, std::type_index>, LayoutCursor> layoutCursors;
+
 };
 
 template <typename... Args>
-std::vector<TypeIndex> World::getTypeIndexes() const
+World::TypeList World::getTypeIndexes(std::pmr::memory_resource* resource) const
 {
-    std::vector<TypeIndex> types;
+    TypeList types(resource);
+    types.reserve(sizeof...(Args));
     getTypeIndex<Args...>(types);
     return types;
 }
 
 template <typename... Args>
-std::vector<TypeIndex> World::getTypeIndexesString(const std::string& name, Args&&... args) const
+World::TypeList World::getTypeIndexesString(std::pmr::memory_resource* resource, const std::string& name, Args&&... args) const
 {
-    std::vector<TypeIndex> types;
+    TypeList types(resource);
+    types.reserve(1 + sizeof...(Args));
     getTypeIndexString(types, name, args...);
     return types;
 }
 
 template <typename... Args>
-void World::getTypeIndexString(std::vector<TypeIndex>& types, const std::string& name1, const std::string& name2, Args&&... args) const
+void World::getTypeIndexString(TypeList& types, const std::string& name1, const std::string& name2, Args&&... args) const
 {
     getTypeIndexString(types, name1);
     getTypeIndexString(types, name2, args...);
 }
 
 template <typename T>
-void World::getTypeIndex(std::vector<TypeIndex>& types) const
+void World::getTypeIndex(TypeList& types) const
 {
     types.emplace_back(typeid(T));
 }
 
 template <typename A, typename B, typename... Args>
-void World::getTypeIndex(std::vector<TypeIndex>& types) const
+void World::getTypeIndex(TypeList& types) const
 {
     getTypeIndex<A>(types);
     getTypeIndex<B, Args...>(types);
@@ -199,20 +465,101 @@ template <typename T, typename... Args>
 World::EntityList World::query()
 {
     // Get all type indexes from component types
-    auto types = getTypeIndexes<T, Args...>();
+    auto types = getTypeIndexes<T, Args...>(std::pmr::get_default_resource());
 
     // Return list of entities with these component types
-    return queryTypes(types);
+    EntityList entities;
+    queryTypes(types, entities);
+    return entities;
 }
 
 template <typename... Args>
 World::EntityList World::query(const std::string& name, Args&&... args)
 {
     // Get all type indexes from component names
-    auto types = getTypeIndexesString(name, args...);
+    auto types = getTypeIndexesString(std::pmr::get_default_resource(), name, args...);
 
     // Return list of entities with these component types
-    return queryTypes(types);
+    EntityList entities;
+    queryTypes(types, entities);
+    return entities;
+}
+
+template <typename T, typename... Args>
+World::PmrEntityList World::query(std::pmr::memory_resource* resource)
+{
+    auto types = getTypeIndexes<T, Args...>(resource);
+    PmrEntityList entities(resource);
+    queryTypes(types, entities);
+    return entities;
+}
+
+template <typename... Args>
+World::PmrEntityList World::query(std::pmr::memory_resource* resource, const std::string& name, Args&&... args)
+{
+    auto types = getTypeIndexesString(resource, name, args...);
+    PmrEntityList entities(resource);
+    queryTypes(types, entities);
+    return entities;
+}
+
+template <typename List>
+void World::queryTypes(TypeList& types, List& entities)
+{
+    // Compute minimum component array size
+    // Note: Arrays are only looked up here, so they aren't created for unused types
+    const auto& components = core.components;
+    size_t minSize = std::numeric_limits<size_t>::max();
+    size_t minIndex = 0;
+    size_t index = 0;
+    for (auto& typeIdx: types)
+    {
+        auto compArray = components[typeIdx.id];
+        assert(compArray);
+        size_t size = compArray->size();
+        if (size < minSize)
+        {
+            minSize = size;
+            minIndex = index;
+        }
+        ++index;
+    }
+
+    // No entities can have all of the types if one of them has no components
+    if (minSize == 0)
+        return;
+
+    // Get minimum type
+    auto minType = types[minIndex].id;
+
+    // Swap-erase the minimum type index from the vector
+    if (types.size() >= 2 && minIndex != types.size() - 1)
+        std::swap(types[minIndex], types.back());
+    types.pop_back();
+
+    // Loop through component array of the minimum size
+    entities.reserve(minSize);
+    iterate(minType, types, entities);
+}
+
+template <typename List>
+void World::iterate(const std::type_index& minType, const TypeList& types, List& entities)
+{
+    auto compArray = core.components[minType];
+    assert(compArray);
+    for (size_t i = 0; i < compArray->positions(); ++i)
+    {
+        if (!compArray->isAlive(i))
+            continue;
+
+        // Get owner ID of component, in order to lookup entity
+        es::ID ownerId = compArray->getElement(i).getOwnerId();
+        auto ent = get(ownerId);
+
+        // Add entity to list if it has all of the component types
+        if (ent.has(types))
+            entities.push_back(ent);
+    }
 }
 
 template <typename T>
@@ -221,6 +568,140 @@ ComponentArrayIter<T> World::getComponents()
     return {core.components.get<T>()};
 }
 
+template <typename T>
+uint64_t World::getVersion() const
+{
+    return core.components.get<T>().getVersion();
+}
+
+template <typename T>
+void World::markChanged()
+{
+    core.components.get<T>().markChanged();
+}
+
+template <typename T>
+SignalSink<T> World::onConstruct()
+{
+    return SignalSink<T>(core.components.getSignals<T>().construct);
+}
+
+template <typename T>
+SignalSink<T> World::onUpdate()
+{
+    return SignalSink<T>(core.components.getSignals<T>().update);
+}
+
+template <typename T>
+SignalSink<T> World::onDestroy()
+{
+    return SignalSink<T>(core.components.getSignals<T>().destroy);
+}
+
+template <typename T>
+void World::setEraseMode(EraseMode mode)
+{
+    core.components.get<T>().setEraseMode(mode);
+}
+
+template <typename T, typename Compare>
+void World::sort(Compare compare)
+{
+    core.components.get<T>().sort(compare);
+}
+
+template <typename T, typename KeyFunc>
+void World::sortBy(KeyFunc keyFunc)
+{
+    core.components.get<T>().sortBy(keyFunc);
+}
+
+template <typename Driver, typename T, typename... Others>
+size_t World::optimizeLayout()
+{
+    return alignLayout<Driver, T, Others...>(std::numeric_limits<size_t>::max());
+}
+
+template <typename Driver, typename T, typename... Others>
+size_t World::optimizeLayout(size_t maxMoves)
+{
+    return alignLayout<Driver, T, Others...>(maxMoves);
+}
+
+template <typename Driver, typename T>
+size_t World::alignLayout(size_t maxMoves)
+{
+    auto& driver = core.components.get<Driver>();
+    auto& comps = core.components.get<T>();
+    std::type_index type{typeid(T)};
+    comps.compact();
+
+    size_t moves = 0;
+    if (maxMoves == std::numeric_limits<size_t>::max())
+    {
+        // Build the new order from the driver array, then apply it all at once
+        std::vector<uint32_t> order;
+        order.reserve(comps.size());
+        std::vector<bool> placed(comps.size());
+        for (size_t i = 0; i < driver.positions(); ++i)
+        {
+            if (!driver.isAlive(i))
+                continue;
+            ID compId = core.getCompId(driver.getElement(i).getOwnerId(), type);
+            if (compId != invalidId)
+            {
+                uint32_t pos = comps.getPosition(compId);
+                placed[pos] = true;
+                order.push_back(pos);
+            }
+        }
+        for (uint32_t pos = 0; pos < placed.size(); ++pos)
+        {
+            if (!placed[pos])
+                order.push_back(pos);
+        }
+        for (uint32_t pos = 0; pos < order.size(); ++pos)
+            moves += (order[pos] != pos);
+        if (moves)
+            comps.reorder(std::move(order));
+    }
+    else
+    {
+        // Swap misplaced components into place, one at a time
+        auto& cursor = layoutCursors[{typeid(Driver), type}];
+        if (cursor.target >= comps.size())
+            cursor = LayoutCursor{};
+        while (moves < maxMoves && cursor.driverPos < driver.positions())
+        {
+            size_t i = cursor.driverPos++;
+            if (!driver.isAlive(i))
+                continue;
+            ID compId = core.getCompId(driver.getElement(i).getOwnerId(), type);
+            if (compId != invalidId)
+            {
+                uint32_t pos = comps.getPosition(compId);
+                if (pos != cursor.target)
+                {
+                    comps.swapPositions(pos, cursor.target);
+                    ++moves;
+                }
+                ++cursor.target;
+            }
+        }
+
+        // Start over next time, once the whole driver array was processed
+        if (cursor.driverPos >= driver.positions())
+            cursor = LayoutCursor{};
+    }
+    return moves;
+}
+
+template <typename Driver, typename A, typename B, typename... Args>
+size_t World::alignLayout(size_t maxMoves)
+{
+    return alignLayout<Driver, A>(maxMoves) + alignLayout<Driver, B, Args...>(maxMoves);
+}
+
 }
 
 #endif
@@ -2,51 +2,80 @@
 // This code is licensed under MIT, see LICENSE.txt for details.
 
 #include <es/componentpool.h>
+#include <iostream>
 
 namespace es
 {
 
 ComponentPool::ComponentPool():
-    data(getStaticData())
+    ComponentPool(std::pmr::get_default_resource())
+{
+}
+
+ComponentPool::ComponentPool(std::pmr::memory_resource* resource):
+    data(getStaticData()),
+    resource(resource),
+    components(resource),
+    localTypeIds(resource),
+    componentSignals(resource)
 {
-    data.instances.insert(this);
-    refresh();
 }
 
 ComponentPool::~ComponentPool()
 {
-    data.instances.erase(this);
 }
 
 bool ComponentPool::validName(const std::string& compName)
 {
-    return (getStaticData().compTypes.find(compName) != getStaticData().compTypes.end());
+    auto& data = getStaticData();
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    return (data.compTypes.find(compName) != data.compTypes.end());
 }
 
 const std::type_index& ComponentPool::getTypeIndex(const std::string& compName)
 {
     // Get the type index from the component name
-    auto found = getStaticData().compTypes.find(compName);
-    if (found != getStaticData().compTypes.end())
+    auto& data = getStaticData();
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    auto found = data.compTypes.find(compName);
+    if (found != data.compTypes.end())
         return found->second.id;
-    return getStaticData().invalidType.id;
+    return data.invalidType.id;
 }
 
 const std::string& ComponentPool::getName(const std::type_index& typeIdx)
 {
     // Get the component name from the type index
     static const std::string emptyStr;
-    auto info = getStaticData().compInfo.find(typeIdx);
-    if (info != getStaticData().compInfo.end())
-        return info->second.name;
+    size_t typeId = findTypeId(typeIdx);
+    if (typeId != invalidTypeId)
+    {
+        auto& data = getStaticData();
+        std::shared_lock<std::shared_mutex> lock(data.mutex);
+        return data.compInfo[typeId].name;
+    }
     return emptyStr;
 }
 
-BaseComponentArray* ComponentPool::operator[](const std::type_index& typeIdx) const
+void BaseComponentArray::warnNotCloned(const std::type_index& typeIdx, size_t count)
+{
+    std::cout << "ComponentArray: Warning, '" << ComponentPool::getName(typeIdx)
+        << "' is not copyable, so " << count << " components were not cloned.\n";
+}
+
+BaseComponentArray* ComponentPool::operator[](const std::type_index& typeIdx)
+{
+    size_t typeId = findLocalTypeId(typeIdx);
+    if (typeId != invalidTypeId)
+        return getArray(typeId);
+    return nullptr;
+}
+
+const BaseComponentArray* ComponentPool::operator[](const std::type_index& typeIdx) const
 {
-    auto found = components.find(typeIdx);
-    if (found != components.end())
-        return found->second.get();
+    size_t typeId = findLocalTypeId(typeIdx);
+    if (typeId != invalidTypeId)
+        return getArray(typeId);
     return nullptr;
 }
 
@@ -63,24 +92,94 @@ const BaseComponentArray* ComponentPool::operator[](const std::string& compName)
 void ComponentPool::reset()
 {
     components.clear();
-    refresh();
 }
 
-void ComponentPool::refresh()
+size_t ComponentPool::arrayCount() const
+{
+    size_t count = 0;
+    for (auto& compArray: components)
+        count += (compArray != nullptr);
+    return count;
+}
+
+bool ComponentPool::hasSignals() const
+{
+    return !componentSignals.empty();
+}
+
+void ComponentPool::compact(float maxRatio, bool stable)
 {
-    for (auto& info: data.compInfo)
-        setupArray(info.first, info.second.array.get());
+    for (auto& compArray: components)
+    {
+        if (compArray)
+            compArray->compactIfNeeded(maxRatio, stable);
+    }
 }
 
-BaseComponentArray* ComponentPool::setupArray(const std::type_index& typeIdx, BaseComponentArray* array)
+size_t ComponentPool::findTypeId(const std::type_index& typeIdx)
 {
-    // Clone the component array if one doesn't already exist for this type index
-    auto& compArray = components[typeIdx];
+    auto& data = getStaticData();
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    auto found = data.typeIds.find(typeIdx);
+    if (found != data.typeIds.end())
+        return found->second;
+    return invalidTypeId;
+}
+
+size_t ComponentPool::findLocalTypeId(const std::type_index& typeIdx) const
+{
+    auto found = localTypeIds.find(typeIdx);
+    if (found != localTypeIds.end())
+        return found->second;
+    return findTypeId(typeIdx);
+}
+
+BaseComponentArray* ComponentPool::createArray(size_t typeId)
+{
+    // Clone the empty registered array, the first time a type is used
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    if (typeId >= components.size())
+        components.resize(data.compInfo.size());
+    auto& compArray = components[typeId];
     if (!compArray)
-        compArray = array->clone();
+    {
+        compArray = data.compInfo[typeId].array->clone(resource);
+        localTypeIds.emplace(data.compInfo[typeId].type.id, typeId);
+        if (typeId < componentSignals.size())
+            compArray->setSignals(componentSignals[typeId].get());
+    }
     return compArray.get();
 }
 
+ComponentSignals& ComponentPool::getSignals(size_t typeId)
+{
+    if (typeId >= componentSignals.size())
+        componentSignals.resize(typeId + 1);
+    auto& typeSignals = componentSignals[typeId];
+    if (!typeSignals)
+    {
+        // Let the array know, if it was already created
+        typeSignals = std::make_unique<ComponentSignals>();
+        if (typeId < components.size() && components[typeId])
+            components[typeId]->setSignals(typeSignals.get());
+    }
+    return *typeSignals;
+}
+
+const BaseComponentArray* ComponentPool::getRegisteredArray(size_t typeId)
+{
+    auto& data = getStaticData();
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    return data.compInfo[typeId].array.get();
+}
+
+std::type_index ComponentPool::getRegisteredType(size_t typeId)
+{
+    auto& data = getStaticData();
+    std::shared_lock<std::shared_mutex> lock(data.mutex);
+    return data.compInfo[typeId].type.id;
+}
+
 ComponentPool::StaticData& ComponentPool::getStaticData()
 {
     static StaticData data;
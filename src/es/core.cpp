@@ -2,11 +2,19 @@
 // This code is licensed under MIT, see LICENSE.txt for details.
 
 #include <es/internal/core.h>
+#include <vector>
 #include <cassert>
 
 namespace es
 {
 
+Core::Core(std::pmr::memory_resource* resource):
+    components(resource),
+    entities(resource),
+    entityNames(resource)
+{
+}
+
 ID Core::create(const std::string& name)
 {
     ID id = entities.create(name);
@@ -40,14 +48,93 @@ void Core::remove(ID id)
 {
     if (isValid(id))
     {
-        // Remove entity and name
+        // Remove components, entity and name
+        removeComponents(id);
         entityNames.erase(entities[id].name);
         entities.erase(id);
     }
 }
 
+void Core::removeComponents(ID id)
+{
+    if (isValid(id))
+    {
+        // Every signal sees the entity with all of its components
+        if (components.hasSignals())
+            signalDestroy(id);
+
+        // Go through component set, and remove components by ID
+        auto& compSet = entities[id].compSet;
+        for (const auto& comp: compSet)
+            components[comp.first]->erase(comp.second);
+        compSet.clear();
+    }
+}
+
+void Core::signalDestroy(ID id)
+{
+    for (const auto& comp: entities[id].compSet)
+    {
+        auto compArray = components[comp.first];
+        auto signals = compArray->getSignals();
+        if (signals)
+            signals->destroy(*this, (*compArray)[comp.second]);
+    }
+}
+
+void Core::merge(Core& srcCore)
+{
+    if (&srcCore == this)
+        return;
+
+    // The entities are destroyed in the other Core, and constructed in this one
+    if (srcCore.components.hasSignals())
+    {
+        for (ID srcId: srcCore.entities.getIndex())
+            srcCore.signalDestroy(srcId);
+    }
+
+    // Create the entities first, mapping the index of each source ID to its new ID
+    std::vector<ID> newIds;
+    entities.reserve(entities.size() + srcCore.entities.size());
+    for (ID srcId: srcCore.entities.getIndex())
+    {
+        uint32_t index = static_cast<uint32_t>(srcId);
+        if (index >= newIds.size())
+            newIds.resize(index + 1, invalidId);
+        newIds[index] = create(srcCore.entities[srcId].name);
+    }
+
+    // Move each component array at once, then add the new component IDs to the entities
+    components.appendFrom(srcCore.components, newIds,
+        [this](const std::type_index& typeIdx, const std::vector<std::pair<ID, ID>>& moved)
+        {
+            for (auto& comp: moved)
+                entities[comp.first].compSet[typeIdx] = comp.second;
+
+            // The new components only need to be visited if something is listening
+            auto compArray = components[typeIdx];
+            auto signals = compArray->getSignals();
+            if (signals)
+            {
+                for (auto& comp: moved)
+                    signals->construct(*this, (*compArray)[comp.second]);
+            }
+        });
+
+    // The components were already moved, so only the entities are left
+    srcCore.entities.clear();
+    srcCore.entityNames.clear();
+}
+
 void Core::clear()
 {
+    // Only visits the entities if something could be listening
+    if (components.hasSignals())
+    {
+        for (ID id: entities.getIndex())
+            signalDestroy(id);
+    }
     entities.clear();
     entityNames.clear();
     components.reset();
@@ -73,4 +160,16 @@ const std::string& Core::getName(ID id) const
     return noName;
 }
 
+ID Core::getCompId(ID id, const std::type_index& typeIdx) const
+{
+    if (isValid(id))
+    {
+        auto& compSet = entities[id].compSet;
+        auto found = compSet.find(typeIdx);
+        if (found != compSet.end())
+            return found->second;
+    }
+    return invalidId;
+}
+
 }
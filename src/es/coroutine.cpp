@@ -0,0 +1,174 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#include <es/coroutine.h>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+namespace es
+{
+
+Scheduler::Scheduler()
+{
+}
+
+Scheduler::~Scheduler()
+{
+    clear();
+}
+
+ID Scheduler::start(Task task)
+{
+    auto handle = task.release();
+    assert(handle);
+    ID taskId = tasks.create(handle);
+    handle.promise().scheduler = this;
+    handle.promise().rootId = taskId;
+
+    // Only an exception from this task is rethrown here, others wait for update()
+    auto pending = std::exchange(exception, nullptr);
+    ++resumeDepth;
+    handle.resume();
+    --resumeDepth;
+    destroyFinished();
+    auto taskException = std::exchange(exception, pending);
+    if (taskException)
+        std::rethrow_exception(taskException);
+    return taskId;
+}
+
+bool Scheduler::cancel(ID taskId)
+{
+    auto task = tasks.get(taskId);
+    if (!task)
+        return false;
+    finished.push_back(*task);
+    tasks.erase(taskId);
+    destroyFinished();
+    return true;
+}
+
+bool Scheduler::isRunning(ID taskId) const
+{
+    return tasks.isValid(taskId);
+}
+
+void Scheduler::update(float newDt)
+{
+    dt = newDt;
+    time += dt;
+
+    // Tasks waiting for this frame
+    resuming.swap(ready);
+
+    // Tasks whose time is up
+    while (!timers.empty() && timers.front().time <= time)
+    {
+        std::pop_heap(timers.begin(), timers.end(), std::greater<Timer>());
+        resuming.push_back(timers.back().waiting);
+        timers.pop_back();
+    }
+
+    // Tasks whose events arrived (the others keep their order)
+    size_t kept = 0;
+    for (auto& waiter: eventWaiters)
+    {
+        if (!tasks.isValid(waiter.waiting.rootId))
+            continue;
+        if (waiter.check(waiter.channel, waiter.frame))
+            resuming.push_back(waiter.waiting);
+        else
+            eventWaiters[kept++] = waiter;
+    }
+    eventWaiters.resize(kept);
+
+    // Tasks that suspend again always wait for a later frame, so they aren't resumed twice
+    // Note: Uses positions, since tasks can start other tasks
+    ++resumeDepth;
+    for (size_t i = 0; i < resuming.size(); ++i)
+    {
+        auto waiting = resuming[i];
+        if (tasks.isValid(waiting.rootId))
+            waiting.handle.resume();
+    }
+    --resumeDepth;
+    resuming.clear();
+    destroyFinished();
+
+    // Rethrown after every task was resumed, so one task can't hold up the others
+    if (exception && resumeDepth == 0)
+        std::rethrow_exception(std::exchange(exception, nullptr));
+}
+
+float Scheduler::getDt() const
+{
+    return dt;
+}
+
+double Scheduler::getTime() const
+{
+    return time;
+}
+
+size_t Scheduler::size() const
+{
+    return tasks.size();
+}
+
+void Scheduler::clear()
+{
+    for (ID taskId: tasks.getIndex())
+        finished.push_back(tasks[taskId]);
+    tasks.clear();
+    ready.clear();
+    timers.clear();
+    eventWaiters.clear();
+    destroyFinished();
+    exception = nullptr;
+}
+
+void Scheduler::resumeNextFrame(ID rootId, std::coroutine_handle<> handle)
+{
+    ready.push_back({rootId, handle});
+}
+
+void Scheduler::resumeAfter(float seconds, ID rootId, std::coroutine_handle<> handle)
+{
+    timers.push_back({time + seconds, timerOrder++, {rootId, handle}});
+    std::push_heap(timers.begin(), timers.end(), std::greater<Timer>());
+}
+
+void Scheduler::resumeOnEvents(EventCheck check, void* channel, uint64_t frame, ID rootId, std::coroutine_handle<> handle)
+{
+    eventWaiters.push_back({check, channel, frame, {rootId, handle}});
+}
+
+void Scheduler::finish(ID rootId, std::exception_ptr taskException)
+{
+    auto task = tasks.get(rootId);
+    if (task)
+    {
+        finished.push_back(*task);
+        tasks.erase(rootId);
+    }
+    if (taskException && !exception)
+        exception = taskException;
+}
+
+void Scheduler::destroyFinished()
+{
+    // A task that is running can't be destroyed yet, such as one that cancels itself
+    if (resumeDepth > 0)
+        return;
+
+    // Note: Destroying a task runs the destructors of its locals, which could cancel other tasks
+    while (!finished.empty())
+    {
+        auto handle = finished.back();
+        finished.pop_back();
+        handle.destroy();
+    }
+}
+
+}
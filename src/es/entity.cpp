@@ -2,6 +2,8 @@
 // This code is licensed under MIT, see LICENSE.txt for details.
 
 #include <es/entity.h>
+#include <iostream>
+#include <vector>
 #include <cassert>
 
 namespace es
@@ -62,6 +64,20 @@ std::vector<std::string> Entity::getNames() const
     return names;
 }
 
+std::pmr::vector<std::pmr::string> Entity::getNames(std::pmr::memory_resource* resource) const
+{
+    std::pmr::vector<std::pmr::string> names(resource);
+    const auto& compSet = core->entities[id].compSet;
+    names.reserve(compSet.size());
+    for (const auto& comp: compSet)
+    {
+        const auto& name = core->components.getName(comp.first);
+        if (!name.empty())
+            names.emplace_back(name);
+    }
+    return names;
+}
+
 Handle<BaseComponentArray, Component> Entity::at(const std::string& name)
 {
     return {core->components[name], atCompId(name)};
@@ -99,12 +115,12 @@ bool Entity::has(const std::string& name) const
 
 bool Entity::has(const std::vector<TypeIndex>& types) const
 {
-    for (auto& typeIdx: types)
-    {
-        if (getCompId(typeIdx.id) == invalidId)
-            return false;
-    }
-    return true;
+    return hasTypes(types.data(), types.size());
+}
+
+bool Entity::has(const std::pmr::vector<TypeIndex>& types) const
+{
+    return hasTypes(types.data(), types.size());
 }
 
 size_t Entity::total() const
@@ -126,14 +142,7 @@ void Entity::remove(const std::string& name)
 
 void Entity::clear()
 {
-    if (valid())
-    {
-        // Go through component set, and remove components by ID
-        auto& compSet = core->entities[id].compSet;
-        for (const auto& comp: compSet)
-            core->components[comp.first]->erase(comp.second);
-        compSet.clear();
-    }
+    core->removeComponents(id);
 }
 
 Entity Entity::clone(const std::string& newName) const
@@ -149,6 +158,44 @@ Entity Entity::clone(Core& newCore, const std::string& newName) const
     return {newCore, newId};
 }
 
+Entity Entity::moveTo(Core& newCore)
+{
+    if (!valid() || core == &newCore)
+        return *this;
+
+    ID newId = newCore.create(core->entities[id].name);
+
+    // The signals can create entities, which moves the entity data, so the components
+        // are listed first, and the entities are looked up again after each signal
+    std::vector<std::pair<std::type_index, ID>> srcComps(core->entities[id].compSet.begin(),
+        core->entities[id].compSet.end());
+    for (auto& srcComp: srcComps)
+    {
+        auto srcCompArray = core->components[srcComp.first];
+        auto destCompArray = newCore.components[srcComp.first];
+        assert(srcCompArray && destCompArray);
+
+        // The component is destroyed in this world before it is moved
+        auto srcSignals = srcCompArray->getSignals();
+        if (srcSignals)
+            srcSignals->destroy(*core, (*srcCompArray)[srcComp.second]);
+
+        // Move the component into the destination array, and remove what's left of it
+        auto compId = destCompArray->moveFrom(*srcCompArray, srcComp.second, newId);
+        (*destCompArray)[compId].ownerId = newId;
+        newCore.entities[newId].compSet[srcComp.first] = compId;
+        srcCompArray->erase(srcComp.second);
+
+        auto destSignals = destCompArray->getSignals();
+        if (destSignals)
+            destSignals->construct(newCore, (*destCompArray)[compId]);
+    }
+    core->entities[id].compSet.clear();
+    core->remove(id);
+    invalidate();
+    return {newCore, newId};
+}
+
 ID Entity::getId() const
 {
     return id;
@@ -194,6 +241,27 @@ std::vector<std::string> Entity::serialize() const
     return comps;
 }
 
+std::pmr::vector<std::pmr::string> Entity::serialize(std::pmr::memory_resource* resource) const
+{
+    std::pmr::vector<std::pmr::string> comps(resource);
+    const auto& compSet = core->entities[id].compSet;
+    comps.reserve(compSet.size());
+    for (const auto& compId: compSet)
+    {
+        const auto& name = core->components.getName(compId.first);
+        auto comp = core->components[compId.first]->get(compId.second);
+        if (!name.empty() && comp)
+        {
+            // Same format as combine()
+            comps.emplace_back(name);
+            auto data = comp->save();
+            if (!data.empty())
+                comps.back().append(1, ' ').append(data);
+        }
+    }
+    return comps;
+}
+
 std::string Entity::serialize(const std::string& name) const
 {
     std::string str;
@@ -240,21 +308,36 @@ Entity& Entity::deserialize(const std::vector<std::string>& componentStrings)
 void Entity::copyComponents(const Core& srcCore, ID srcId, Core& destCore, ID destId) const
 {
     // Loop through source entity's components, and copy each one
-    auto& destCompSet = destCore.entities[destId].compSet;
-    for (auto srcCompId: srcCore.entities[srcId].compSet)
+    // The signals can create entities, which moves the entity data, so the components
+        // are listed first, and the destination entity is looked up again for each one
+    auto& srcCompSet = srcCore.entities[srcId].compSet;
+    std::vector<std::pair<std::type_index, ID>> srcComps(srcCompSet.begin(), srcCompSet.end());
+    for (auto& srcCompId: srcComps)
     {
         // Get the destination component array to copy components into
         auto destCompArray = destCore.components[srcCompId.first];
         assert(destCompArray);
 
+        // Move-only components can't be copied, so they are skipped
+        if (!destCompArray->isCopyable())
+        {
+            std::cout << "Entity: Warning, '" << ComponentPool::getName(srcCompId.first)
+                << "' is not copyable, so it was not copied.\n";
+            continue;
+        }
+
         // Copy the component from the source array to the destination array
-        auto id = destCompArray->copyFrom(*srcCore.components[srcCompId.first], srcCompId.second);
+        auto id = destCompArray->copyFrom(*srcCore.components[srcCompId.first], srcCompId.second, destId);
 
         // Update the destination entity to have the newly copied component ID
-        destCompSet[srcCompId.first] = id;
+        destCore.entities[destId].compSet[srcCompId.first] = id;
 
         // Update the owner ID to be the destination entity ID
         (*destCompArray)[id].ownerId = destId;
+
+        auto signals = destCompArray->getSignals();
+        if (signals)
+            signals->construct(destCore, (*destCompArray)[id]);
     }
 }
 
@@ -265,14 +348,7 @@ ID Entity::getCompId(const std::string& name) const
 
 ID Entity::getCompId(const std::type_index& typeIdx) const
 {
-    if (valid())
-    {
-        auto& compSet = core->entities[id].compSet;
-        auto found = compSet.find(typeIdx);
-        if (found != compSet.end())
-            return found->second;
-    }
-    return invalidId;
+    return core->getCompId(id, typeIdx);
 }
 
 ID Entity::atCompId(const std::string& name)
@@ -284,25 +360,38 @@ ID Entity::atCompId(const std::string& name)
         if (compArray)
         {
             // Create new component
-            compId = compArray->create();
+            compId = compArray->createFor(id);
 
             // Add component ID to this entity's component set
             core->entities[id].compSet[core->components.getTypeIndex(name)] = compId;
 
             // Update owner ID
             (*compArray)[compId].ownerId = id;
+            notify(*compArray, compId, &ComponentSignals::construct);
         }
     }
     return compId;
 }
 
+bool Entity::hasTypes(const TypeIndex* types, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (getCompId(types[i].id) == invalidId)
+            return false;
+    }
+    return true;
+}
+
 void Entity::removeComp(const std::type_index& typeIdx)
 {
     ID compId = getCompId(typeIdx);
     if (compId != invalidId)
     {
         // Erase actual component and ID from component set
-        core->components[typeIdx]->erase(compId);
+        auto compArray = core->components[typeIdx];
+        notify(*compArray, compId, &ComponentSignals::destroy);
+        compArray->erase(compId);
         core->entities[id].compSet.erase(typeIdx);
     }
 }
@@ -14,8 +14,20 @@ bool loadPrototypes(const std::string& configFilename)
     return loader.load();
 }
 
+bool loadPrototypes(const std::string& configFilename, World& bank)
+{
+    EntityPrototypeLoader loader(configFilename, bank);
+    return loader.load();
+}
+
 EntityPrototypeLoader::EntityPrototypeLoader(const std::string& configFilename):
-    config(configFilename)
+    EntityPrototypeLoader(configFilename, World::prototypes)
+{
+}
+
+EntityPrototypeLoader::EntityPrototypeLoader(const std::string& configFilename, World& bank):
+    config(configFilename),
+    bank(bank)
 {
 }
 
@@ -102,7 +114,7 @@ void EntityPrototypeLoader::loadComponents(const std::string& entityName, const
 {
     // Load each component from a string in the section
     for (auto& option: section)
-        World::prototypes[entityName].deserialize(option.first, option.second.toString());
+        bank[entityName].deserialize(option.first, option.second.toString());
 }
 
 }
@@ -0,0 +1,92 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#include <es/internal/framearena.h>
+#include <cstdint>
+#include <algorithm>
+
+namespace es
+{
+
+FrameArena::FrameArena(size_t initialSize, std::pmr::memory_resource* upstream):
+    initialSize(initialSize ? initialSize : 1),
+    upstream(upstream)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    release();
+}
+
+void FrameArena::reset()
+{
+    current = 0;
+    offset = 0;
+    usedBefore = 0;
+}
+
+void FrameArena::release()
+{
+    for (auto& block: blocks)
+        upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+    blocks.clear();
+    reset();
+}
+
+size_t FrameArena::capacity() const
+{
+    size_t total = 0;
+    for (auto& block: blocks)
+        total += block.size;
+    return total;
+}
+
+size_t FrameArena::used() const
+{
+    return usedBefore + offset;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    // Try the current block, and then any blocks kept from previous frames
+    while (current < blocks.size())
+    {
+        void* ptr = allocateFromCurrent(bytes, alignment);
+        if (ptr)
+            return ptr;
+        usedBefore += offset;
+        ++current;
+        offset = 0;
+    }
+
+    // Add a new block, which is at least double the size of the last one
+    size_t size = std::max(bytes + alignment, blocks.empty() ? initialSize : blocks.back().size * 2);
+    auto data = static_cast<unsigned char*>(upstream->allocate(size, alignof(std::max_align_t)));
+    blocks.push_back(Block{data, size});
+    current = blocks.size() - 1;
+    return allocateFromCurrent(bytes, alignment);
+}
+
+void FrameArena::do_deallocate(void*, size_t, size_t)
+{
+    // Everything is freed at once by reset()
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void* FrameArena::allocateFromCurrent(size_t bytes, size_t alignment)
+{
+    auto& block = blocks[current];
+    auto address = reinterpret_cast<uintptr_t>(block.data) + offset;
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (offset + padding + bytes > block.size)
+        return nullptr;
+    offset += padding + bytes;
+    return block.data + (offset - bytes);
+}
+
+}
@@ -2,10 +2,28 @@
 // This code is licensed under MIT, see LICENSE.txt for details.
 
 #include <es/systemcontainer.h>
+#include <numeric>
+#include <cmath>
 
 namespace es
 {
 
+namespace
+{
+
+// Clears the deadline of a system when it goes out of scope, even if update() throws
+struct DeadlineGuard
+{
+    System& system;
+
+    ~DeadlineGuard()
+    {
+        system.setDeadline(System::Clock::time_point::max());
+    }
+};
+
+}
+
 SystemContainer::SystemContainer()
 {
 }
@@ -29,15 +47,30 @@ void SystemContainer::initializeAll()
 
 void SystemContainer::updateAll(float dt)
 {
+    // Resume the coroutines that are done waiting
+    scheduler.update(dt);
+
     // Call update on all of the systems
     for (auto& s: systems)
-        s.ptr->update(dt);
+        updateSystem(s, dt);
+    ++frame;
+}
+
+uint64_t SystemContainer::getFrame() const
+{
+    return frame;
+}
+
+Scheduler& SystemContainer::getScheduler()
+{
+    return scheduler;
 }
 
 void SystemContainer::clear()
 {
     systemTypes.clear();
     systems.clear();
+    scheduler.clear();
 }
 
 size_t SystemContainer::size() const
@@ -53,6 +86,91 @@ size_t SystemContainer::getIndex(const std::type_index& type) const
     return invalidIndex;
 }
 
+void SystemContainer::setPolicy(size_t index, const UpdatePolicy& policy)
+{
+    auto& system = systems[index];
+    system.policy = policy;
+    system.elapsed = 0.0f;
+    if (system.policy.interval == 0)
+        system.policy.interval = 1;
+    if (system.policy.phase == UpdatePolicy::autoPhase)
+        system.policy.phase = pickPhase(index, system.policy.interval);
+    system.policy.phase %= system.policy.interval;
+}
+
+unsigned SystemContainer::pickPhase(size_t index, unsigned interval) const
+{
+    // Two systems land on the same frame when their phases are equal modulo
+        // the greatest common divisor of their intervals
+    unsigned bestPhase = 0;
+    size_t bestCount = std::numeric_limits<size_t>::max();
+    for (unsigned phase = 0; phase < interval && bestCount > 0; ++phase)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < systems.size(); ++i)
+        {
+            auto& other = systems[i].policy;
+            if (i != index && other.interval > 1)
+            {
+                unsigned divisor = std::gcd(interval, other.interval);
+                count += (phase % divisor == other.phase % divisor);
+            }
+        }
+        if (count < bestCount)
+        {
+            bestCount = count;
+            bestPhase = phase;
+        }
+    }
+    return bestPhase;
+}
+
+void SystemContainer::updateSystem(SystemPtr& system, float dt)
+{
+    auto& policy = system.policy;
+    system.elapsed += dt;
+
+    // Systems with triggers are skipped while their inputs stay the same
+    // The triggers are checked every frame, since events only trigger for one frame
+    bool triggered = system.ptr->checkTriggers();
+    if (frame % policy.interval != policy.phase || !triggered)
+        return;
+
+    // Fixed step systems wait until a whole step passed, and keep their triggers until then
+    if (policy.step > 0.0f && (system.elapsed < policy.step || policy.maxSteps == 0))
+        return;
+
+    DeadlineGuard deadlineGuard{*system.ptr};
+    if (policy.budget > 0.0f)
+    {
+        auto budget = std::chrono::duration_cast<System::Clock::duration>(std::chrono::duration<float>(policy.budget));
+        system.ptr->setDeadline(System::Clock::now() + budget);
+    }
+
+    // The system can request another update while it is updated
+    system.ptr->clearPendingUpdate();
+
+    if (policy.step > 0.0f)
+    {
+        // Use up the elapsed time in fixed steps, and keep what's left for next time
+        unsigned steps = 0;
+        for (; system.elapsed >= policy.step && steps < policy.maxSteps; ++steps)
+        {
+            system.ptr->update(policy.step);
+            system.elapsed -= policy.step;
+        }
+        if (system.elapsed >= policy.step)
+            system.elapsed = std::fmod(system.elapsed, policy.step);
+    }
+    else
+    {
+        system.ptr->update(system.elapsed);
+        system.elapsed = 0.0f;
+    }
+
+    system.ptr->resetTriggers();
+}
+
 void SystemContainer::updateSystemTypes(size_t start)
 {
     for (size_t i = start; i < systems.size(); ++i)
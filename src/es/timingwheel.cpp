@@ -0,0 +1,135 @@
+// Copyright (C) 2015-2016 Eric Hebert (ayebear)
+// This code is licensed under MIT, see LICENSE.txt for details.
+
+#include <es/internal/timingwheel.h>
+#include <cassert>
+
+namespace es
+{
+
+TimingWheel::TimingWheel()
+{
+}
+
+ID TimingWheel::schedule(uint64_t ticks, TimerTarget& target, ID value)
+{
+    assert(ticks > 0);
+    if (slots.empty())
+        slots.resize(levelCount * slotCount);
+    uint64_t deadline = tick + ticks;
+    ID timerId = timers.create(Timer{&target, value, deadline});
+    insert(timerId, deadline);
+    return timerId;
+}
+
+bool TimingWheel::cancel(ID timerId)
+{
+    auto timer = timers.get(timerId);
+    if (!timer)
+        return false;
+
+    // The timer's ID is left in its slot, and skipped when it is reached
+    Timer cancelled = *timer;
+    timers.erase(timerId);
+    cancelled.target->cancel(cancelled.value);
+    return true;
+}
+
+void TimingWheel::cancelAll(TimerTarget& target)
+{
+    for (ID timerId: timers.getIndex())
+    {
+        if (timers[timerId].target == &target)
+            cancel(timerId);
+    }
+}
+
+bool TimingWheel::isPending(ID timerId) const
+{
+    return timers.isValid(timerId);
+}
+
+void TimingWheel::advance(uint64_t ticks)
+{
+    // Once there are no timers left, the rest of the ticks can be skipped
+    for (; ticks > 0 && timers.size() > 0; --ticks)
+        step();
+    tick += ticks;
+}
+
+uint64_t TimingWheel::getTick() const
+{
+    return tick;
+}
+
+size_t TimingWheel::size() const
+{
+    return timers.size();
+}
+
+void TimingWheel::clear()
+{
+    for (ID timerId: timers.getIndex())
+        cancel(timerId);
+    for (auto& slot: slots)
+        slot.clear();
+}
+
+void TimingWheel::insert(ID timerId, uint64_t deadline)
+{
+    // The level is picked by the highest bit that differs from the current tick
+    uint64_t diff = deadline ^ tick;
+    unsigned level = 0;
+    while (level + 1 < levelCount && (diff >> ((level + 1) * slotBits)) != 0)
+        ++level;
+    getSlot(level, deadline).push_back(timerId);
+}
+
+void TimingWheel::cascade(unsigned level)
+{
+    pending.swap(getSlot(level, tick));
+    for (ID timerId: pending)
+    {
+        auto timer = timers.get(timerId);
+        if (timer)
+            insert(timerId, timer->deadline);
+    }
+    pending.clear();
+}
+
+void TimingWheel::step()
+{
+    ++tick;
+
+    // Find the levels whose slots start at this tick
+    unsigned levels = 1;
+    while (levels < levelCount && (tick & ((uint64_t(1) << (levels * slotBits)) - 1)) == 0)
+        ++levels;
+
+    // Move their timers down, starting from the highest level, so timers can move
+        // down more than one level in the same tick
+    for (unsigned level = levels - 1; level > 0; --level)
+        cascade(level);
+
+    // Expire the timers of this tick
+    // Note: New timers never go into this slot, since they expire after this tick
+    pending.swap(getSlot(0, tick));
+    for (ID timerId: pending)
+    {
+        auto timer = timers.get(timerId);
+        if (timer)
+        {
+            Timer expired = *timer;
+            timers.erase(timerId);
+            expired.target->expire(expired.value);
+        }
+    }
+    pending.clear();
+}
+
+TimingWheel::Slot& TimingWheel::getSlot(unsigned level, uint64_t deadline)
+{
+    return slots[level * slotCount + ((deadline >> (level * slotBits)) & (slotCount - 1))];
+}
+
+}
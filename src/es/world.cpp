@@ -6,6 +6,11 @@
 namespace es
 {
 
+World::World(std::pmr::memory_resource* resource):
+    core(resource)
+{
+}
+
 World World::prototypes;
 
 Entity World::create(const std::string& name)
@@ -15,7 +20,7 @@ Entity World::create(const std::string& name)
 
 Entity World::copy(const std::string& prototypeName, const std::string& name)
 {
-    return prototypes.get(prototypeName).clone(core, name);
+    return prototypeBank->get(prototypeName).clone(core, name);
 }
 
 Entity World::clone(const std::string& prototypeName, const std::string& name)
@@ -23,6 +28,20 @@ Entity World::clone(const std::string& prototypeName, const std::string& name)
     return copy(prototypeName, name);
 }
 
+Entity World::migrate(ID id, World& destWorld)
+{
+    return get(id).moveTo(destWorld.core);
+}
+
+void World::merge(World&& srcWorld)
+{
+    // Merging a world into itself doesn't change anything
+    if (&srcWorld == this)
+        return;
+    srcWorld.eventBus.getTimers().cancelAll(srcWorld.destroyer);
+    core.merge(srcWorld.core);
+}
+
 Entity World::operator[](const std::string& name)
 {
     return {core, core[name]};
@@ -68,9 +87,21 @@ void World::destroy(const std::string& name)
 
 void World::clear()
 {
+    // The IDs can be used again after clearing, so the timers must not outlive them
+    eventBus.getTimers().cancelAll(destroyer);
     core.clear();
 }
 
+ID World::destroyAfter(ID id, uint64_t frames)
+{
+    if (frames == 0)
+    {
+        destroy(id);
+        return invalidId;
+    }
+    return eventBus.getTimers().schedule(frames, destroyer, id);
+}
+
 World::EntityList World::query()
 {
     EntityList entities;
@@ -79,6 +110,52 @@ World::EntityList World::query()
     return entities;
 }
 
+World::PmrEntityList World::query(std::pmr::memory_resource* resource)
+{
+    PmrEntityList entities(resource);
+    entities.reserve(core.entities.size());
+    for (auto id: core.entities.getIndex(resource))
+        entities.emplace_back(core, id);
+    return entities;
+}
+
+void World::nextFrame()
+{
+    frameArena.reset();
+    eventBus.nextFrame();
+    ++frame;
+}
+
+uint64_t World::getFrame() const
+{
+    return frame;
+}
+
+std::pmr::memory_resource* World::frameMemory()
+{
+    return &frameArena;
+}
+
+EventBus& World::events()
+{
+    return eventBus;
+}
+
+void World::setPrototypes(World& bank)
+{
+    prototypeBank = &bank;
+}
+
+World& World::getPrototypes()
+{
+    return *prototypeBank;
+}
+
+void World::compact(float maxRatio, bool stable)
+{
+    core.components.compact(maxRatio, stable);
+}
+
 bool World::valid(ID id) const
 {
     return core.isValid(id);
@@ -99,63 +176,19 @@ World::operator Core&()
     return core;
 }
 
-bool World::validName(const std::string& compName)
+void World::EntityDestroyer::expire(ID id)
 {
-    return ComponentPool::validName(compName);
+    Entity(core, id).destroy();
 }
 
-void World::getTypeIndexString(std::vector<TypeIndex>& types, const std::string& name) const
-{
-    types.emplace_back(ComponentPool::getTypeIndex(name));
-}
-
-World::EntityList World::queryTypes(std::vector<TypeIndex>& types)
+bool World::validName(const std::string& compName)
 {
-    // Compute minimum component array size
-    size_t minSize = std::numeric_limits<size_t>::max();
-    size_t minIndex = 0;
-    size_t index = 0;
-    for (auto& typeIdx: types)
-    {
-        auto compArray = core.components[typeIdx.id];
-        assert(compArray);
-        size_t size = compArray->size();
-        if (size < minSize)
-        {
-            minSize = size;
-            minIndex = index;
-        }
-        ++index;
-    }
-
-    // Get minimum type
-    auto minType = types[minIndex].id;
-
-    // Swap-erase the minimum type index from the vector
-    if (types.size() >= 2 && minIndex != types.size() - 1)
-        std::swap(types[minIndex], types.back());
-    types.pop_back();
-
-    // Loop through component array of the minimum size
-    return iterate(minType, types);
+    return ComponentPool::validName(compName);
 }
 
-World::EntityList World::iterate(const std::type_index& minType, std::vector<TypeIndex>& types)
+void World::getTypeIndexString(TypeList& types, const std::string& name) const
 {
-    EntityList entities;
-    auto compArray = core.components[minType];
-    assert(compArray);
-    for (size_t i = 0; i < compArray->size(); ++i)
-    {
-        // Get owner ID of component, in order to lookup entity
-        es::ID ownerId = compArray->getElement(i).getOwnerId();
-        auto ent = get(ownerId);
-
-        // Add entity to list if it has all of the component types
-        if (ent.has(types))
-            entities.push_back(ent);
-    }
-    return entities;
+    types.emplace_back(ComponentPool::getTypeIndex(name));
 }
 
 }
@@ -5,8 +5,11 @@
 #include <iostream>
 #include <chrono>
 #include <deque>
+#include <map>
 #include <cassert>
 #include <algorithm>
+#include <thread>
+#include <stdexcept>
 #include <es/es.h>
 
 int main()
@@ -25,7 +28,7 @@ double getElapsedTime(const std::chrono::time_point<std::chrono::system_clock>&
 
 void runTests()
 {
-    es::registerComponents<Position, Velocity, Size, Sprite>();
+    es::registerComponents<Position, Velocity, Size, Sprite, Health, Boss, Texture, Fragile>();
     std::cout << "Running all tests...\n";
     packedArrayTests();
     packedArrayBenchmarks();
@@ -145,6 +148,26 @@ void packedArrayTests()
     auto constHandle = constElems.getHandle(constId);
     assert(constHandle && constHandle->name == "Const" && constHandle.access().num == 999 && constHandle.get()->num == 999);
 
+    // The epoch only changes when elements are added, removed, or moved
+    auto epoch = elements.getEpoch();
+    auto cachedHandle = elements.getHandle(constId);
+    assert(cachedHandle->num == 999);
+    elements[constId].num = 1000;
+    assert(elements.getEpoch() == epoch);
+    assert(cachedHandle->num == 1000);
+    auto sortId = elements.create("Sort", 1);
+    assert(elements.getEpoch() != epoch);
+    elements.sort([](const Test& a, const Test& b){ return a.num < b.num; });
+    assert(cachedHandle->num == 1000 && cachedHandle->name == "Const");
+    elements.erase(sortId);
+    assert(cachedHandle->num == 1000);
+    epoch = elements.getEpoch();
+    decltype(elements) otherElements;
+    otherElements.create("Other", 5);
+    elements = otherElements;
+    assert(elements.getEpoch() != epoch);
+    assert(cachedHandle.get() == elements.get(constId));
+
     // Invalid elements
     es::PackedArray<std::string> strs;
     auto invId = strs.create("test1");
@@ -165,6 +188,247 @@ void packedArrayTests()
     strs.erase(testId2);
     assert(!strs.get(testId1) && !strs.get(testId2) && !strs.get(testId3));
 
+    // Chunked storage (addresses don't change when growing)
+    es::PackedArray<Test, es::ChunkedStorage<16>> chunked;
+    auto chunkedId = chunked.create("Stable", 42);
+    auto chunkedPtr = chunked.get(chunkedId);
+    for (int i = 0; i < 1000; ++i)
+        chunked.create("FILL", i);
+    assert(chunked.get(chunkedId) == chunkedPtr && chunkedPtr->num == 42);
+    size_t blocks = 0;
+    size_t blockElems = 0;
+    chunked.forEachBlock([&](Test* data, size_t count) {
+        assert(data && count <= 16);
+        ++blocks;
+        blockElems += count;
+    });
+    assert(blocks == 63 && blockElems == 1001 && chunked.size() == 1001);
+    chunked.erase(chunkedId);
+    assert(!chunked.get(chunkedId) && chunked.size() == 1000);
+    assert(chunked.begin()->name == "FILL" && chunked.begin()->num == 999);
+    size_t chunkedCount = 0;
+    for (auto& elem: chunked)
+        chunkedCount += (elem.name == "FILL");
+    assert(chunkedCount == 1000);
+    auto chunkedCopy = chunked;
+    chunked.clear();
+    assert(chunked.size() == 0 && chunkedCopy.size() == 1000);
+
+    // Reserved storage (contiguous, grows in place)
+    es::PackedArray<int, es::ReservedStorage<100000>> reserved;
+    auto reservedId = reserved.create(7);
+    auto reservedPtr = reserved.get(reservedId);
+    for (int i = 0; i < 50000; ++i)
+        reserved.create(i);
+    assert(reserved.get(reservedId) == reservedPtr && *reservedPtr == 7);
+    size_t reservedBlocks = 0;
+    reserved.forEachBlock([&](int* data, size_t count) {
+        assert(data == reservedPtr && count == 50001);
+        ++reservedBlocks;
+    });
+    assert(reservedBlocks == 1);
+    reserved.erase(reservedId);
+    assert(!reserved.get(reservedId) && reserved[reserved.create(8)] == 8);
+
+    // IDs with the unused bit set never match a free slot
+    es::DenseIndex<> freeDense;
+    es::PagedIndex<64> freePaged;
+    es::PID densePid = freeDense.add(0), pagedPid = freePaged.add(0);
+    freeDense.add(1);
+    freePaged.add(1);
+    freeDense.remove(densePid.index);
+    freePaged.remove(pagedPid.index);
+    es::PID denseFree = freeDense.entry(densePid.index), pagedFree = freePaged.entry(pagedPid.index);
+    assert(!denseFree.used() && !freeDense.isValid(es::PID{denseFree.version, densePid.index}));
+    assert(!pagedFree.used() && !freePaged.isValid(es::PID{pagedFree.version, pagedPid.index}));
+    es::PackedArray<int> freeArray;
+    es::PID freeArrayPid{freeArray.create(1)};
+    freeArray.create(2);
+    freeArray.erase(freeArrayPid.id());
+    freeArrayPid.incVersion();
+    freeArrayPid.setUsed(false);
+    assert(!freeArray.isValid(freeArrayPid.id()) && !freeArray.get(freeArrayPid.id()));
+
+    // Paged index (empty pages are freed, and IDs are never reused)
+    static_assert(sizeof(es::PID) == 8, "PID should be 8 bytes");
+    es::PackedArray<int, es::VectorStorage, es::PagedIndex<64>> paged;
+    std::vector<es::ID> pagedIds;
+    for (int i = 0; i < 1000; ++i)
+        pagedIds.push_back(paged.create(i));
+    auto firstPagedId = pagedIds.front();
+    for (size_t i = 0; i < pagedIds.size(); ++i)
+    {
+        if (i % 100 != 0)
+            paged.erase(pagedIds[i]);
+    }
+    assert(paged.size() == 10 && paged.getIndex().size() == 10);
+    assert(paged[pagedIds[500]] == 500 && !paged.get(pagedIds[501]));
+    paged.erase(firstPagedId);
+    assert(!paged.isValid(firstPagedId));
+    std::vector<es::ID> newPagedIds;
+    for (int i = 0; i < 1000; ++i)
+        newPagedIds.push_back(paged.create(i));
+    for (auto oldId: pagedIds)
+        assert(std::find(newPagedIds.begin(), newPagedIds.end(), oldId) == newPagedIds.end());
+    for (auto newId: newPagedIds)
+        paged.erase(newId);
+    for (size_t i = 100; i < pagedIds.size(); i += 100)
+        paged.erase(pagedIds[i]);
+    assert(paged.size() == 0 && paged.getIndex().empty());
+    es::PagedIndex<64> pagedIndex;
+    for (uint32_t i = 0; i < 640; ++i)
+        pagedIndex.add(i);
+    for (uint32_t i = 0; i < 640; ++i)
+    {
+        if (i != 5)
+            pagedIndex.remove(i);
+    }
+    assert(pagedIndex.allocatedPages() == 1 && pagedIndex.slots() == 640);
+
+    // Memory resources (everything is allocated from the given resource)
+    CountingResource counting;
+    {
+        es::PackedArray<int> pmrVector(&counting);
+        es::PackedArray<int, es::ChunkedStorage<16>, es::PagedIndex<64>> pmrChunked(&counting);
+        std::vector<es::ID> pmrIds;
+        for (int i = 0; i < 100; ++i)
+        {
+            pmrIds.push_back(pmrVector.create(i));
+            pmrChunked.create(i);
+        }
+        assert(counting.allocated > 0);
+        auto pmrCopy = pmrChunked;
+        size_t allocationsBefore = counting.allocations;
+        // Sorting reorders the elements in place, without allocating another array
+        pmrVector.sortBy([](int value) { return -value; });
+        assert(pmrVector[pmrIds[10]] == 10 && counting.allocations == allocationsBefore);
+        assert(*pmrVector.begin() == 99 && pmrCopy.size() == 100);
+    }
+    assert(counting.allocated == 0);
+
+    // Tombstone erase mode (order is kept until compacting)
+    es::PackedArray<int> ordered;
+    ordered.setEraseMode(es::EraseMode::Tombstone);
+    std::vector<es::ID> orderedIds;
+    for (int i = 0; i < 10; ++i)
+        orderedIds.push_back(ordered.create(i));
+    ordered.erase(orderedIds[2]);
+    ordered.erase(orderedIds[5]);
+    ordered.erase(orderedIds[9]);
+    assert(ordered.size() == 7 && ordered.positions() == 9 && ordered.getTombstones() == 2);
+    std::vector<int> orderedValues(ordered.begin(), ordered.end());
+    assert((orderedValues == std::vector<int>{0, 1, 3, 4, 6, 7, 8}));
+    assert(!ordered.compactIfNeeded(0.5f));
+    ordered.compact();
+    assert(ordered.size() == 7 && ordered.positions() == 7 && ordered.getTombstones() == 0);
+    assert(ordered[orderedIds[8]] == 8 && ordered[orderedIds[3]] == 3 && !ordered.get(orderedIds[2]));
+    assert((std::vector<int>(ordered.begin(), ordered.end()) == orderedValues));
+    ordered.erase(orderedIds[0]);
+    ordered.erase(orderedIds[1]);
+    ordered.erase(orderedIds[3]);
+    ordered.erase(orderedIds[8]);
+    assert(ordered.size() == 3 && ordered.getTombstones() == 3);
+    ordered.compact(false);
+    assert(ordered.size() == 3 && ordered.positions() == 3);
+    assert(ordered[orderedIds[4]] == 4 && ordered[orderedIds[6]] == 6 && ordered[orderedIds[7]] == 7);
+    ordered.erase(orderedIds[4]);
+    ordered.setEraseMode(es::EraseMode::Swap);
+    assert(ordered.size() == 2 && ordered.positions() == 2 && ordered[orderedIds[7]] == 7);
+
+    // Tombstones free what they hold right away
+    es::PackedArray<std::shared_ptr<int>> owners;
+    owners.setEraseMode(es::EraseMode::Tombstone);
+    auto shared = std::make_shared<int>(5);
+    auto ownerId = owners.create(shared);
+    owners.create(shared);
+    assert(shared.use_count() == 3);
+    owners.erase(ownerId);
+    assert(owners.getTombstones() == 1 && shared.use_count() == 2);
+
+    // Sorting (IDs stay valid)
+    es::PackedArray<Test> sorted;
+    std::vector<es::ID> sortedIds;
+    const int sortValues[] = {5, -3, 100, 0, -50, 7, 7, 2};
+    for (int value: sortValues)
+        sortedIds.push_back(sorted.create(std::to_string(value), value));
+    sorted.sortBy([](const Test& t) { return t.num; });
+    std::vector<int> sortedNums;
+    for (auto& elem: sorted)
+        sortedNums.push_back(elem.num);
+    assert(std::is_sorted(sortedNums.begin(), sortedNums.end()));
+    for (size_t i = 0; i < sortedIds.size(); ++i)
+        assert(sorted[sortedIds[i]].num == sortValues[i]);
+    sorted.sortBy([](const Test& t) { return -0.5f * t.num; });
+    assert(sorted.begin()->num == 100);
+    sorted.sortBy([](const Test& t) { return t.name; });
+    assert(sorted.begin()->name == "-3");
+    sorted.sort([](const Test& a, const Test& b) { return a.num > b.num; });
+    assert(sorted.begin()->num == 100);
+    sorted.erase(sortedIds[2]);
+    sorted.erase(sortedIds[4]);
+    for (size_t i = 0; i < sortedIds.size(); ++i)
+        assert(i == 2 || i == 4 || sorted[sortedIds[i]].num == sortValues[i]);
+
+    // Reordering in place follows each cycle of the permutation
+    std::vector<int> beforeNums;
+    for (auto& elem: sorted)
+        beforeNums.push_back(elem.num);
+    const std::vector<uint32_t> cycleOrder = {1, 0, 3, 4, 2, 5};
+    sorted.reorder(cycleOrder);
+    for (uint32_t pos = 0; pos < cycleOrder.size(); ++pos)
+        assert(sorted.getElement(pos).num == beforeNums[cycleOrder[pos]]);
+    for (size_t i = 0; i < sortedIds.size(); ++i)
+        assert(i == 2 || i == 4 || sorted[sortedIds[i]].num == sortValues[i]);
+
+    // Cursors visit each element once per cycle, even when others are erased and moved
+    es::PackedArray<Test> cursorElems;
+    std::vector<es::ID> cursorIds;
+    for (int i = 0; i < 1000; ++i)
+        cursorIds.push_back(cursorElems.create("", i));
+    std::vector<int> visits(2000);
+    es::Cursor cursor;
+    auto visit = [&visits](Test& elem) { ++visits[elem.num]; };
+    assert(cursor.advance(cursorElems, 100, visit) == 100);
+    for (int i = 0; i < 1000; i += 3)
+        cursorElems.erase(cursorIds[i]);
+    cursorElems.sortBy([](const Test& t) { return -t.num; });
+    for (int i = 1000; i < 1100; ++i)
+        cursorElems.create("", i);
+    while (cursor.getCycles() == 0)
+        cursor.advance(cursorElems, 50, visit);
+    for (int i = 1; i < 1000; ++i)
+        assert(i % 3 == 0 || visits[i] == 1);
+    for (int i = 1000; i < 1100; ++i)
+        assert(visits[i] <= 1);
+    assert(cursor.getSlot() == 0);
+    std::fill(visits.begin(), visits.end(), 0);
+    size_t visitedCount = 0;
+    while (cursor.getCycles() == 1)
+        visitedCount += cursor.advance(cursorElems, 64, visit);
+    assert(visitedCount == cursorElems.size());
+    for (int i = 0; i < 1100; ++i)
+        assert(visits[i] == (i < 1000 && i % 3 == 0 ? 0 : 1));
+    size_t whileCount = cursor.advanceWhile(cursorElems, [](Test& elem) { return elem.num != 500; });
+    assert(whileCount > 0 && whileCount < cursorElems.size());
+
+    // Cursors scan a limited number of empty slots per call
+    es::PackedArray<Test> sparseElems;
+    std::vector<es::ID> sparseIds;
+    for (int i = 0; i < 1000; ++i)
+        sparseIds.push_back(sparseElems.create("", i));
+    for (int i = 0; i < 990; ++i)
+        sparseElems.erase(sparseIds[i]);
+    es::Cursor sparseCursor;
+    int sparseVisits = 0;
+    auto sparseVisit = [&sparseVisits](Test&) { ++sparseVisits; };
+    assert(sparseCursor.advance(sparseElems, 10, sparseVisit) == 0 && sparseCursor.getSlot() == 40);
+    assert(sparseCursor.advance(sparseElems, 10, sparseVisit, 100) == 0 && sparseCursor.getSlot() == 140);
+    assert(sparseCursor.advanceWhile(sparseElems, [](Test&) { return true; }, 200) == 0);
+    assert(sparseCursor.getSlot() == 340 && sparseCursor.getCycles() == 0);
+    while (sparseCursor.getCycles() == 0)
+        sparseCursor.advance(sparseElems, 10, sparseVisit);
+    assert(sparseVisits == 10);
+
     std::cout << "PackedArray tests passed.\n";
 }
 
@@ -201,7 +465,28 @@ void packedArrayBenchmarks()
     for (size_t i = 0; i < numElems; ++i)
         array.create(i);
     std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+
+    start = std::chrono::system_clock::now();
+    std::cout << "Running benchmark 2a... (radix sorting)\n";
+    array.sortBy([](size_t value) { return (value * 2654435761u) % 1000003; });
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+
+    auto handle = array.getHandle(array.getIndex().front());
+    size_t sum = 0;
+    start = std::chrono::system_clock::now();
+    std::cout << "Running benchmark 2b... (dereferencing the same handle)\n";
+    for (size_t i = 0; i < numElems * 10; ++i)
+        sum += *handle;
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+    assert(sum == *handle * numElems * 10);
     array.clear();
+
+    es::PackedArray<size_t, es::ReservedStorage<numElems>> reservedArray;
+    start = std::chrono::system_clock::now();
+    std::cout << "Running benchmark 3... (creating without reserving, reserved storage)\n";
+    for (size_t i = 0; i < numElems; ++i)
+        reservedArray.create(i);
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
 }
 
 void serializationTests()
@@ -330,6 +615,40 @@ void componentPoolTests()
     // auto baseHandle = comps["Position"]->getBaseHandle(posId);
     // assert(baseHandle && baseHandle->save() == "555 963");
 
+    // Arrays are only created when they're used
+    es::ComponentPool lazyComps;
+    assert(lazyComps.arrayCount() == 0);
+    const auto& constLazyComps = lazyComps;
+    assert(constLazyComps.get<Velocity>().size() == 0 && constLazyComps["Sprite"]->size() == 0);
+    assert(lazyComps.arrayCount() == 0);
+    lazyComps.get<Velocity>().create(1, 2);
+    assert(lazyComps.arrayCount() == 1 && constLazyComps.get<Velocity>().size() == 1);
+    assert(lazyComps["Size"] && lazyComps.arrayCount() == 2);
+    assert(lazyComps["Invalid"] == nullptr && lazyComps.arrayCount() == 2);
+
+    // Types registered after a pool is created can still be used by it
+    struct LateComponent: public es::Component
+    {
+        int value {7};
+    };
+    es::ComponentPool::registerComponent<LateComponent>("LateComponent");
+    assert(lazyComps.get<LateComponent>()[lazyComps.get<LateComponent>().create()].value == 7);
+    assert(lazyComps["LateComponent"]->size() == 1);
+    lazyComps.reset();
+    assert(lazyComps.arrayCount() == 0);
+
+    // Queries don't create arrays either
+    es::World lazyWorld;
+    lazyWorld.create() << Position(1, 2);
+    assert((lazyWorld.query<Position, Sprite>().empty()));
+    assert(static_cast<es::Core&>(lazyWorld).components.arrayCount() == 1);
+
+    // Move-only components can't be cloned, which prints a warning
+    es::ComponentArray<Texture> textures;
+    textures.create(16);
+    auto clonedTextures = textures.clone(std::pmr::get_default_resource());
+    assert(!clonedTextures->isCopyable() && clonedTextures->size() == 0 && textures.size() == 1);
+
     std::cout << "ComponentPool tests passed.\n";
 }
 
@@ -473,9 +792,143 @@ void entityTests()
     ent3 = ent2;
     assert(ent3);
 
+    // Constructing components in place
+    es::World emplaceWorld;
+    auto empEnt = emplaceWorld.create();
+    auto posPtr = empEnt.emplace<Position>(1, 2);
+    assert(posPtr && posPtr->x == 1 && posPtr->getOwnerId() == empEnt.getId());
+    assert(empEnt.emplace<Position>(5, 6) == posPtr);
+    assert(posPtr->x == 1);
+    assert(!empEnt.replace<Velocity>(3, 4));
+    assert(!empEnt.has<Velocity>());
+    assert(empEnt.replace<Position>(7, 8) == posPtr);
+    assert(posPtr->x == 7 && posPtr->y == 8 && posPtr->getOwnerId() == empEnt.getId());
+    auto spritePtr = empEnt.emplaceOrReplace<Sprite>("first.png");
+    assert(spritePtr && spritePtr->filename == "first.png");
+    assert(empEnt.emplaceOrReplace<Sprite>("second.png") == spritePtr);
+    assert(empEnt.at<Sprite>()->filename == "second.png");
+    assert(spritePtr->getOwnerId() == empEnt.getId());
+    assert(empEnt.patch<Position>([](Position& pos){ pos.x += 10; }));
+    assert(posPtr->x == 17);
+    assert(!empEnt.patch<Velocity>([](Velocity& vel){ vel.x = 1; }));
+    assert(!empEnt.has<Velocity>());
+    assert(empEnt.emplaceOrReplace<Health>(5)->value == 5);
+    assert(empEnt.emplaceOrReplace<Health>(6)->value == 6);
+    assert(empEnt.emplace<Boss>("Emplaced")->title == "Emplaced");
+    assert(empEnt.replace<Boss>("Replaced")->title == "Replaced");
+
+    // Replacing with a copy of the component itself
+    assert(empEnt.replace<Boss>(*empEnt.getPtr<Boss>())->title == "Replaced");
+    assert(empEnt.emplaceOrReplace<Sprite>(*empEnt.getPtr<Sprite>())->filename == "second.png");
+    assert(empEnt.getPtr<Sprite>()->getOwnerId() == empEnt.getId());
+    es::Entity invalidEnt{emplaceWorld};
+    assert(!invalidEnt.emplace<Position>());
+    assert(!invalidEnt.emplaceOrReplace<Position>());
+    assert(!invalidEnt.replace<Position>());
+    assert(!invalidEnt.patch<Position>([](Position&){}));
+
+    // Move-only components
+    es::World textureWorld;
+    auto texEnt = textureWorld.create("tex");
+    texEnt.assign<Texture>(16);
+    assert(texEnt.at<Texture>()->pixels->size() == 16);
+    Texture bigTexture(64);
+    auto pixels = bigTexture.pixels.get();
+    texEnt << std::move(bigTexture);
+    assert(texEnt.at<Texture>()->pixels.get() == pixels);
+    assert(texEnt.at<Texture>()->getOwnerId() == texEnt.getId());
+    for (int i = 0; i < 5; ++i)
+        textureWorld.create() << Texture(i) << Position(i, i);
+    textureWorld.destroy(textureWorld.query<Texture, Position>().front().getId());
+    textureWorld.sortBy<Texture>([](const Texture& tex){ return tex.pixels->size(); });
+    assert(textureWorld.getComponents<Texture>().size() == 5);
+    assert(texEnt.at<Texture>()->pixels.get() == pixels);
+
+    // Move-only components are skipped when copying, but can be moved
+    std::cout << "Note: Warning should be shown below:\n";
+    auto texCopy = texEnt.clone();
+    assert(texCopy.has<Position>() == texEnt.has<Position>());
+    assert(!texCopy.has<Texture>());
+    es::World otherTextureWorld;
+    auto movedTex = textureWorld.migrate(texEnt.getId(), otherTextureWorld);
+    assert(movedTex.at<Texture>()->pixels.get() == pixels);
+    otherTextureWorld.merge(std::move(textureWorld));
+    assert(otherTextureWorld.getComponents<Texture>().size() == 5);
+
+    // A component whose constructor throws isn't added, and isn't changed
+    es::World fragileWorld;
+    auto fragileEnt = fragileWorld.create();
+    auto throws = [](auto func)
+    {
+        try
+        {
+            func();
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    };
+    assert(throws([&] { fragileEnt.assign<Fragile>(-1); }));
+    assert(throws([&] { fragileEnt.emplace<Fragile>(-2); }));
+    assert(throws([&] { fragileEnt.emplaceOrReplace<Fragile>(-3); }));
+    assert(!fragileEnt.has<Fragile>() && !fragileEnt.getPtr<Fragile>());
+    fragileEnt.assign<Fragile>(1);
+    assert(fragileEnt.has<Fragile>() && fragileEnt.getPtr<Fragile>()->value == 1);
+    assert(throws([&] { fragileEnt.assign<Fragile>(-4); }));
+    assert(throws([&] { fragileEnt.emplaceOrReplace<Fragile>(-5); }));
+    assert(fragileEnt.getPtr<Fragile>()->value == 1);
+    assert(fragileWorld.getComponents<Fragile>().size() == 1);
+
     std::cout << "Entity tests passed.\n";
 }
 
+// Keeps a copy of every Position in a world, like a spatial hash would
+struct PositionMirror
+{
+    std::map<es::ID, float> xs;
+    int updates {0};
+
+    void onConstruct(es::Entity& ent, Position& pos)
+    {
+        xs[ent.getId()] = pos.x;
+    }
+
+    void onUpdate(es::Entity& ent, Position& pos)
+    {
+        xs[ent.getId()] = pos.x;
+        ++updates;
+    }
+
+    void onDestroy(es::Entity& ent, Position& pos)
+    {
+        assert(ent.has<Position>() && ent.getPtr<Position>() == &pos);
+        xs.erase(ent.getId());
+    }
+};
+
+// Creates entities whenever a component is constructed, which moves the entity data
+struct Spawner
+{
+    es::World* world{nullptr};
+    int spawned {0};
+
+    void onConstruct(es::Entity&, Health&)
+    {
+        for (int i = 0; i < 100; ++i)
+            world->create();
+        ++spawned;
+    }
+};
+
+int healthDestroyed = 0;
+
+void countHealthDestroyed(es::Entity&, Health&)
+{
+    ++healthDestroyed;
+}
+
 void worldTests()
 {
     // Create entities
@@ -625,6 +1078,29 @@ void worldTests()
     for (const auto& pos: world.getComponents<Position>())
         assert(pos.x == 25 && pos.y == 40);
 
+    // Tombstones are skipped when iterating and querying
+    world.setEraseMode<Position>(es::EraseMode::Tombstone);
+    world["test1"].remove<Position>();
+    assert(world.getComponents<Position>().size() == 2);
+    assert(world.query<Position>().size() == 2);
+    numComponents = 0;
+    for (auto& pos: world.getComponents<Position>())
+        numComponents += (pos.x == 25);
+    assert(numComponents == 2);
+    world.compact();
+    world["test1"] << Position(25, 40);
+    world.setEraseMode<Position>(es::EraseMode::Swap);
+
+    // Sorting components
+    world["test2"].access<Position>().x = 1;
+    world.sortBy<Position>([](const Position& pos) { return pos.x; });
+    assert(world.getComponents<Position>().begin()->x == 1);
+    assert(world["test2"].get<Position>()->x == 1);
+    world.sort<Position>([](const Position& a, const Position& b) { return a.x > b.x; });
+    assert(world.getComponents<Position>().begin()->x == 25);
+    assert(world["test2"].get<Position>()->x == 1);
+    world["test2"].access<Position>().x = 25;
+
     // Iterating through components using owner ID
     world["test4"] << Position(1, 2) << Velocity(3, 4);
     world["test5"] << Position(5, 6) << Velocity(7, 8);
@@ -642,6 +1118,169 @@ void worldTests()
         }
     }
 
+    // Layout optimization (Position/Velocity follow the order of Size)
+    es::World layoutWorld;
+    std::vector<es::Entity> layoutEnts;
+    for (int i = 0; i < 50; ++i)
+    {
+        auto layoutEnt = layoutWorld.create();
+        if (i % 3 != 0)
+            layoutEnt << Position(i, 0);
+        if (i % 2 == 0)
+            layoutEnt << Velocity(i, 0);
+        layoutEnts.push_back(layoutEnt);
+    }
+    for (int i = 49; i >= 0; --i)
+        layoutEnts[i] << Size(i, 0);
+    auto checkLayout = [&](size_t count) {
+        auto pos = layoutWorld.getComponents<Position>().begin();
+        for (auto& size: layoutWorld.getComponents<Size>())
+        {
+            if (count-- == 0)
+                break;
+            if (layoutWorld.from(size).has<Position>())
+                assert((pos++)->getOwnerId() == size.getOwnerId());
+        }
+    };
+    assert((layoutWorld.optimizeLayout<Size, Position, Velocity>(5)) <= 10);
+    while (layoutWorld.optimizeLayout<Size, Position, Velocity>(5)) {}
+    checkLayout(50);
+    assert((layoutWorld.optimizeLayout<Size, Position, Velocity>()) == 0);
+    layoutWorld.sortBy<Size>([](const Size& size) { return size.x; });
+    assert((layoutWorld.optimizeLayout<Size, Position, Velocity>()) > 0);
+    checkLayout(50);
+    for (auto& vel: layoutWorld.getComponents<Velocity>())
+        assert(layoutWorld.from(vel).get<Velocity>()->x == vel.x);
+
+    // Dense and hash component layouts
+    es::World layoutsWorld;
+    std::vector<es::Entity> layoutsEnts;
+    for (int i = 0; i < 20; ++i)
+        layoutsEnts.push_back(layoutsWorld.create().assign<Health>(i));
+    layoutsEnts[3] << Boss("Dragon");
+    layoutsEnts[12].assign<Boss>("Lich");
+    assert(layoutsEnts[5].get<Health>()->value == 5);
+    assert(layoutsEnts[3].get<Boss>()->title == "Dragon");
+    assert(layoutsEnts[12].get("Boss")->save() == "Lich");
+    assert(!layoutsEnts[4].has<Boss>());
+    layoutsEnts[7].remove<Health>();
+    auto oldBossId = layoutsEnts[3].getId();
+    layoutsEnts[3].destroy();
+    assert(layoutsWorld.getComponents<Health>().size() == 18);
+    assert(layoutsWorld.getComponents<Boss>().size() == 1);
+    int healthTotal = 0;
+    for (auto& health: layoutsWorld.getComponents<Health>())
+    {
+        assert(layoutsWorld.from(health).get<Health>()->value == health.value);
+        healthTotal += health.value;
+    }
+    assert(healthTotal == 190 - 7 - 3);
+    size_t healthBlocks = 0;
+    layoutsWorld.getComponents<Health>().forEachBlock([&](Health*, size_t) { ++healthBlocks; });
+    assert(healthBlocks == 3);
+
+    // Reusing an entity index doesn't make the old component ID valid
+    auto reusedEnt = layoutsWorld.create();
+    assert(reusedEnt.getId() != oldBossId && !reusedEnt.has<Health>() && !reusedEnt.has<Boss>());
+    reusedEnt << Health(50) << Boss("Golem");
+    assert(layoutsWorld.getComponents<Health>().size() == 19);
+    assert(!layoutsWorld.getComponents<Boss>().begin()->title.empty());
+
+    // Copying entities with dense and hash components
+    auto bossCopy = layoutsEnts[12].clone();
+    assert(bossCopy.get<Boss>()->title == "Lich" && bossCopy.get<Health>()->value == 12);
+    assert(bossCopy.get<Boss>()->getOwnerId() == bossCopy.getId());
+
+    // Copying in the same world, while the arrays grow
+    es::World growWorld;
+    auto growEnt = growWorld.create();
+    growEnt << Health(77) << Boss("Hydra");
+    for (int i = 0; i < 100; ++i)
+    {
+        auto growCopy = growEnt.clone();
+        assert(growCopy.get<Health>()->value == 77 && growCopy.get<Boss>()->title == "Hydra");
+    }
+    assert(growWorld.getComponents<Health>().size() == 101 && growWorld.getComponents<Boss>().size() == 101);
+    layoutsWorld.compact();
+    layoutsWorld.clear();
+    assert(layoutsWorld.getComponents<Health>().size() == 0);
+
+    // Worlds allocating from a memory resource
+    CountingResource worldResource;
+    {
+        es::World pmrWorld(&worldResource);
+        size_t emptyAllocations = worldResource.allocations;
+        for (int i = 0; i < 100; ++i)
+            pmrWorld.create() << Position(i, i) << Health(i);
+        assert(worldResource.allocations > emptyAllocations);
+        auto pmrClone = pmrWorld.create() << Sprite("test.png");
+        assert(pmrClone.clone().get<Sprite>()->filename == "test.png");
+        assert(pmrWorld.getComponents<Position>().size() == 100);
+    }
+    assert(worldResource.allocated == 0);
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        es::World arenaWorld(&arena);
+        for (int i = 0; i < 100; ++i)
+            arenaWorld.create("ent" + std::to_string(i)) << Position(i, i) << Velocity(1, 1);
+        for (auto& pos: arenaWorld.getComponents<Position>())
+            pos.x += arenaWorld.from(pos).get<Velocity>()->x;
+        assert(arenaWorld["ent5"].get<Position>()->x == 6);
+    }
+
+    // Frame arena (memory is reused after the first frame)
+    CountingResource arenaUpstream;
+    {
+        es::FrameArena arena(256, &arenaUpstream);
+        for (int frame = 0; frame < 5; ++frame)
+        {
+            std::pmr::vector<int> numbers(&arena);
+            for (int i = 0; i < 1000; ++i)
+                numbers.push_back(i);
+            std::pmr::string text("a string that is too long for the small string optimization", &arena);
+            assert(numbers[999] == 999 && arena.used() > 4000);
+            if (frame == 0)
+                arenaUpstream.allocations = 0;
+            arena.reset();
+            assert(arena.used() == 0);
+        }
+        assert(arenaUpstream.allocations == 0);
+        auto aligned = arena.allocate(64, 64);
+        assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+        arena.release();
+        assert(arena.capacity() == 0);
+    }
+    assert(arenaUpstream.allocated == 0);
+
+    // Querying with the world's frame memory
+    es::World frameWorld;
+    for (int i = 0; i < 50; ++i)
+    {
+        auto frameEnt = frameWorld.create() << Position(i, i);
+        if (i % 2)
+            frameEnt << Velocity(1, 2);
+    }
+    CountingResource defaultCounter;
+    auto oldDefault = std::pmr::set_default_resource(&defaultCounter);
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        auto memory = frameWorld.frameMemory();
+        auto allEnts = frameWorld.query(memory);
+        auto moving = frameWorld.query<Position, Velocity>(memory);
+        auto movingByName = frameWorld.query(memory, "Velocity", "Position");
+        assert(allEnts.size() == 50 && moving.size() == 25 && movingByName.size() == 25);
+        auto names = moving.front().getNames(memory);
+        auto comps = moving.front().serialize(memory);
+        assert(names.size() == 2 && comps.size() == 2);
+        assert(std::find(comps.begin(), comps.end(), "Velocity 1 2") != comps.end());
+        es::Core& frameCore = frameWorld;
+        assert(frameCore.entities.getIndex(memory).size() == 50);
+        frameWorld.nextFrame();
+    }
+    std::pmr::set_default_resource(oldDefault);
+    assert(defaultCounter.allocations == 0);
+    assert(frameWorld.getFrame() == 3);
+
     // Handle pointer tests with the world
     auto test1Ent = world["test1"];
     auto ptr1 = test1Ent.get<Position>().get();
@@ -666,17 +1305,232 @@ void worldTests()
     assert(constBasePos->save() == "10 10");
     assert(constBasePosPtr->save() == "10 10");
 
+    // Migrating entities moves their components into another world
+    es::World srcWorld, destWorld;
+    auto mover = srcWorld.create("mover");
+    mover << Position(3, 4) << Sprite("moved.png") << Health(3) << Boss("Big");
+    auto stayer = srcWorld.create("stayer");
+    stayer << Position(5, 6) << Health(8);
+    auto moved = srcWorld.migrate(mover.getId(), destWorld);
+    assert(moved && moved.total() == 4);
+    assert(moved.getName() == "mover");
+    assert(destWorld["mover"].getId() == moved.getId());
+    assert(moved.at<Position>()->x == 3);
+    assert(moved.at<Sprite>()->filename == "moved.png");
+    assert(moved.at<Health>()->value == 3);
+    assert(moved.at<Boss>()->title == "Big");
+    assert(moved.at<Position>()->getOwnerId() == moved.getId());
+    assert(!srcWorld.valid("mover") && srcWorld.size() == 1);
+    assert(srcWorld.getComponents<Position>().size() == 1);
+    assert(srcWorld.getComponents<Sprite>().size() == 0);
+    assert(srcWorld.getComponents<Boss>().size() == 0);
+    assert(stayer.at<Health>()->value == 8);
+    assert(!srcWorld.migrate(es::invalidId, destWorld));
+
+    // Merging moves everything, and remaps the IDs
+    es::World chunk;
+    for (int i = 0; i < 10; ++i)
+    {
+        auto ent = chunk.create();
+        ent << Position(i, i) << Health(i);
+        if (i % 2 == 0)
+            ent << Sprite("chunk.png");
+        if (i == 9)
+            ent << Boss("Chunk boss");
+    }
+    chunk.destroy(chunk.query<Health>().front().getId());
+    chunk.create("named") << Velocity(1, 1);
+    destWorld.merge(std::move(chunk));
+    assert(chunk.size() == 0);
+    assert(chunk.getComponents<Position>().size() == 0);
+    assert(destWorld.size() == 11);
+    assert(destWorld.getComponents<Position>().size() == 10);
+    assert(destWorld.getComponents<Health>().size() == 10);
+    assert(destWorld.getComponents<Sprite>().size() == 5);
+    assert((destWorld.query<Position, Health>().size() == 10));
+    assert(destWorld.query<Boss>().size() == 2);
+    destWorld.merge(std::move(destWorld));
+    assert(destWorld.size() == 11 && destWorld.getComponents<Position>().size() == 10);
+    assert(destWorld["named"].at<Velocity>()->x == 1);
+    for (auto ent: destWorld.query<Position, Health>())
+    {
+        assert(ent.at<Position>()->x == ent.at<Health>()->value);
+        assert(ent.at<Position>()->getOwnerId() == ent.getId());
+        assert(ent.at<Health>()->getOwnerId() == ent.getId());
+    }
+    for (auto ent: destWorld.query<Boss>())
+        assert(ent.at<Boss>()->getOwnerId() == ent.getId());
+
+    // Entities can be destroyed after a number of frames
+    es::World despawnWorld;
+    auto shortLived = despawnWorld.create("shortLived");
+    auto longLived = despawnWorld.create("longLived");
+    auto saved = despawnWorld.create("saved");
+    despawnWorld.destroyAfter(shortLived.getId(), 1);
+    despawnWorld.destroyAfter(longLived.getId(), 600);
+    auto savedTimer = despawnWorld.destroyAfter(saved.getId(), 1);
+    assert(despawnWorld.events().cancelTimer(savedTimer));
+    assert(despawnWorld.destroyAfter(despawnWorld.create().getId(), 0) == es::invalidId);
+    assert(despawnWorld.size() == 3);
+    despawnWorld.nextFrame();
+    assert(!shortLived && longLived && saved && despawnWorld.size() == 2);
+    for (int frame = 1; frame < 599; ++frame)
+        despawnWorld.nextFrame();
+    assert(longLived);
+    despawnWorld.nextFrame();
+    assert(!longLived && saved);
+    despawnWorld.destroyAfter(saved.getId(), 1);
+    despawnWorld.clear();
+    assert(despawnWorld.events().getTimers().size() == 0);
+
+    // Cursors work with each component layout
+    es::World cursorWorld;
+    for (int i = 0; i < 50; ++i)
+    {
+        auto ent = cursorWorld.create();
+        ent << Position(i, 0) << Health(i);
+        if (i % 10 == 0)
+            ent << Boss("Boss");
+    }
+    es::Cursor posCursor, healthCursor, bossCursor;
+    int positionsSeen = 0, healthSeen = 0, bossesSeen = 0;
+    posCursor.advance(cursorWorld.getComponents<Position>(), 20, [&](Position&) { ++positionsSeen; });
+    for (auto ent: cursorWorld.query<Position>())
+    {
+        if (static_cast<int>(ent.at<Position>()->x) % 2 == 0)
+            ent.destroy();
+    }
+    while (posCursor.getCycles() == 0)
+        posCursor.advance(cursorWorld.getComponents<Position>(), 20, [&](Position&) { ++positionsSeen; });
+    while (healthCursor.getCycles() == 0)
+        healthCursor.advance(cursorWorld.getComponents<Health>(), 7, [&](Health&) { ++healthSeen; });
+    while (bossCursor.getCycles() == 0)
+        bossCursor.advance(cursorWorld.getComponents<Boss>(), 1, [&](Boss&) { ++bossesSeen; });
+    assert(positionsSeen >= 25 && positionsSeen <= 45);
+    assert(healthSeen == 25 && bossesSeen == 0);
+    cursorWorld.create() << Boss("Odd boss");
+    while (bossCursor.getCycles() == 1)
+        bossCursor.advance(cursorWorld.getComponents<Boss>(), 1, [&](Boss&) { ++bossesSeen; });
+    assert(bossesSeen == 1);
+
+    // Lifecycle signals keep the mirror in sync without scanning the components
+    es::World signalWorld, otherWorld;
+    PositionMirror mirror, otherMirror;
+    signalWorld.onConstruct<Position>().connect<&PositionMirror::onConstruct>(mirror);
+    signalWorld.onUpdate<Position>().connect<&PositionMirror::onUpdate>(mirror);
+    signalWorld.onDestroy<Position>().connect<&PositionMirror::onDestroy>(mirror);
+    signalWorld.onConstruct<Position>().connect<&PositionMirror::onConstruct>(mirror);
+    assert(signalWorld.onConstruct<Position>().size() == 1);
+    signalWorld.onDestroy<Health>().connect<&countHealthDestroyed>();
+    otherWorld.onConstruct<Position>().connect<&PositionMirror::onConstruct>(otherMirror);
+    otherWorld.onDestroy<Position>().connect<&PositionMirror::onDestroy>(otherMirror);
+    assert(signalWorld.onUpdate<Velocity>().empty());
+
+    auto sig1 = signalWorld.create("sig1");
+    sig1 << Position(1, 1) << Health(1);
+    assert(mirror.xs.size() == 1 && mirror.xs[sig1.getId()] == 1);
+    sig1 << Position(2, 2);
+    sig1.assign<Position>(3.0f, 3.0f);
+    assert(mirror.xs[sig1.getId()] == 3 && mirror.updates == 2);
+    sig1.patch<Position>([](Position& pos) { pos.x = 4; });
+    sig1.replace<Position>(5.0f);
+    assert(mirror.xs[sig1.getId()] == 5 && mirror.updates == 4);
+    sig1.at<Position>()->x = 6;
+    assert(mirror.xs[sig1.getId()] == 5 && mirror.updates == 4);
+
+    auto sig2 = signalWorld.create();
+    sig2.emplace<Position>(7.0f);
+    sig2.emplace<Position>(8.0f);
+    auto sig3 = signalWorld.create();
+    sig3["Position"].load("9 9");
+    auto sig4 = sig1.clone();
+    assert(mirror.xs.size() == 4 && mirror.updates == 4);
+    assert(mirror.xs[sig2.getId()] == 7 && mirror.xs[sig3.getId()] == 0 && mirror.xs[sig4.getId()] == 6);
+
+    sig2.remove<Position>();
+    sig3.remove("Position");
+    assert(mirror.xs.size() == 2);
+    sig1.destroy();
+    assert(mirror.xs.size() == 1 && healthDestroyed == 1);
+
+    // Migrating destroys in one world, and constructs in the other
+    auto migrated = signalWorld.migrate(sig4.getId(), otherWorld);
+    assert(mirror.xs.empty() && healthDestroyed == 2);
+    assert(otherMirror.xs.size() == 1 && otherMirror.xs[migrated.getId()] == 6);
+    signalWorld.create() << Position(10, 10);
+    otherWorld.merge(std::move(signalWorld));
+    assert(mirror.xs.empty() && otherMirror.xs.size() == 2);
+    otherWorld.clear();
+    assert(otherMirror.xs.empty());
+
+    // Listeners can create entities while components are copied or moved
+    es::World spawnWorld, otherSpawnWorld;
+    Spawner spawner{&spawnWorld}, otherSpawner{&otherSpawnWorld};
+    spawnWorld.onConstruct<Health>().connect<&Spawner::onConstruct>(spawner);
+    otherSpawnWorld.onConstruct<Health>().connect<&Spawner::onConstruct>(otherSpawner);
+    auto spawnEnt = spawnWorld.create("spawn");
+    spawnEnt << Position(1, 2) << Health(3) << Velocity(4, 5);
+    for (int i = 0; i < 5; ++i)
+        spawnEnt = spawnEnt.clone();
+    assert(spawner.spawned == 6 && spawnWorld.size() == 606);
+    assert((spawnEnt.has<Position, Health, Velocity>()));
+    assert(spawnEnt.getPtr<Position>()->y == 2 && spawnEnt.getPtr<Health>()->value == 3);
+    assert(spawnEnt.getPtr<Velocity>()->x == 4 && spawnEnt.getPtr<Health>()->getOwnerId() == spawnEnt.getId());
+    auto spawnMoved = spawnWorld.migrate(spawnEnt.getId(), otherSpawnWorld);
+    assert(otherSpawner.spawned == 1 && spawnWorld.size() == 605 && otherSpawnWorld.size() == 101);
+    assert((spawnMoved.has<Position, Health, Velocity>()));
+    assert(spawnMoved.getPtr<Position>()->x == 1 && spawnMoved.getPtr<Health>()->value == 3);
+    assert(spawnMoved.getPtr<Velocity>()->y == 5 && spawnMoved.getPtr<Health>()->getOwnerId() == spawnMoved.getId());
+
+    // Signals are kept after clearing, and disconnected functions aren't called
+    signalWorld.create() << Position(11, 11);
+    assert(mirror.xs.size() == 1);
+    signalWorld.onConstruct<Position>().disconnect<&PositionMirror::onConstruct>(mirror);
+    signalWorld.create() << Position(12, 12);
+    assert(mirror.xs.size() == 1);
+    signalWorld.clear();
+    assert(mirror.xs.empty());
+
     std::cout << "World tests passed.\n";
 }
 
 void worldBenchmarks()
 {
     es::loadPrototypes("entities.cfg");
+
+    // Short-lived worlds only create the arrays they use
+    auto start = std::chrono::system_clock::now();
+    std::cout << "Creating short-lived worlds...\n";
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        es::World tempWorld;
+        tempWorld.create() << Position(1, 2);
+    }
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+
+    // Merging a world built somewhere else, compared with cloning each entity
+    auto buildChunk = [](es::World& chunk){
+        for (size_t i = 0; i < 100000; ++i)
+            chunk.create() << Position(1, 2) << Velocity(3, 4) << Sprite("chunk.png");
+    };
+    es::World chunk, cloned, merged;
+    buildChunk(chunk);
+    start = std::chrono::system_clock::now();
+    std::cout << "Cloning entities into another world...\n";
+    for (auto ent: chunk.query())
+        ent.clone(cloned);
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+    start = std::chrono::system_clock::now();
+    std::cout << "Merging the world...\n";
+    merged.merge(std::move(chunk));
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+    assert(merged.size() == cloned.size());
+
     es::World world;
 
     // Create some entities with random components
     srand(time(nullptr));
-    auto start = std::chrono::system_clock::now();
+    start = std::chrono::system_clock::now();
     std::cout << "Creating random entities...\n";
     for (size_t i = 0; i < 100000; ++i)
     {
@@ -738,6 +1592,25 @@ void worldBenchmarks()
     std::cout << "NOTE: Smart direct iteration is " << speedup << "x the speed of query().\n\n";
 
 
+    start = std::chrono::system_clock::now();
+    std::cout << "Optimizing layout...\n";
+    world.optimizeLayout<Size, Position, Velocity>();
+    std::cout << "Done in " << getElapsedTime(start) << " seconds.\n";
+
+    start = std::chrono::system_clock::now();
+    std::cout << "Directly iterating (smart, optimized layout)...\n";
+    for (auto& size: world.getComponents<Size>())
+    {
+        auto ent = world.from(size);
+        auto vel = ent.get<Velocity>();
+        auto pos = ent.get<Position>();
+        if (vel && pos) {}
+    }
+    et3 = getElapsedTime(start);
+    std::cout << "Done in " << et3 << " seconds.\n";
+    speedup = (et + et2) / et3;
+    std::cout << "NOTE: Smart direct iteration with an optimized layout is " << speedup << "x the speed of query().\n\n";
+
     start = std::chrono::system_clock::now();
     std::cout << "Directly iterating (dumb)...\n";
     std::cout << '\t' << world.getComponents<Position>().size() << " elements\n";
@@ -845,11 +1718,294 @@ void prototypeTests()
     assert(ent2 && ent2.total() == 0);
     auto ent3 = world.copy("invalid");
     assert(ent3 && ent3.total() == 0);
+
+    // Per-world prototype banks
+    es::World bank;
+    status = es::loadPrototypes("entities.cfg", bank);
+    assert(status);
+    bank["Box"] << Position(5, 6);
+    es::World world2;
+    assert(&world2.getPrototypes() == &es::World::prototypes);
+    world2.setPrototypes(bank);
+    assert(&world2.getPrototypes() == &bank);
+    auto box2 = world2.copy("Box");
+    assert(box2.total() == 3);
+    assert(box2["Position"].save() == "5 6");
+    assert(world.copy("Box")["Position"].save() != "5 6");
 }
 
+struct TestEvent
+{
+    TestEvent(int value = 0): value(value) {}
+    int value;
+};
+
 void eventTests()
 {
+    // Global events
+    es::Events::send(TestEvent(1));
+    es::Events::send<TestEvent>(2);
+    assert(es::Events::exists<TestEvent>());
+    assert(es::Events::get<TestEvent>().size() == 2);
+    assert(es::Events::get<TestEvent>().getCurrent().back().value == 2);
+    assert(es::Events::getTotal() == 2);
+
+    // Iterating over global events sees every event until they are cleared
+    int globalSum = 0;
+    for (auto& event: es::Events::get<TestEvent>())
+        globalSum += event.value;
+    assert(globalSum == 3);
+
+    // Each world has its own events
+    es::World world1, world2;
+    world1.events().send(TestEvent(3));
+    assert(world1.events().getTotal() == 1);
+    assert(!world2.events().exists<TestEvent>());
+    assert(es::Events::getTotal() == 2);
+    world1.events().clear<TestEvent>();
+    assert(!world1.events().exists<TestEvent>());
+
+    // Global events are shared by all threads
+    std::thread([]{
+        assert(es::Events::getTotal() == 2);
+        es::Events::send(TestEvent(4));
+    }).join();
+    assert(es::Events::getTotal() == 3);
+    es::Events::clearAll();
+    assert(!es::Events::exists<TestEvent>());
+
+    // Events are double buffered, and dropped after the frame after they were sent
+    es::World frameWorld;
+    auto& channel = frameWorld.events().channel<TestEvent>();
+    assert(&channel == &frameWorld.events().get<TestEvent>());
+    channel.send(TestEvent(10));
+    channel.send(11);
+    assert(channel.size() == 2 && channel.getCurrent().size() == 2 && channel.getPrevious().empty());
+    frameWorld.nextFrame();
+    assert(channel.size() == 2 && frameWorld.events().getTotal() == 2);
+    channel.send(12);
+    assert(channel.getPrevious().size() == 2 && channel.getCurrent().size() == 1);
+    std::vector<int> values;
+    std::vector<uint64_t> frames;
+    auto allEvents = channel.all();
+    for (auto it = allEvents.begin(); it != allEvents.end(); ++it)
+    {
+        values.push_back(it->value);
+        frames.push_back(it.frame());
+    }
+    assert((values == std::vector<int>{10, 11, 12}));
+    assert((frames == std::vector<uint64_t>{0, 0, 1}));
+
+    // Iterating only sees the events from the last frame, so each one is seen once
+    values.clear();
+    for (auto& event: channel)
+        values.push_back(event.value);
+    assert((values == std::vector<int>{10, 11}));
+    frameWorld.nextFrame();
+    assert(channel.size() == 1 && frameWorld.events().getTotal() == 1);
+    assert(channel.getPrevious().front().value == 12 && channel.getCurrent().empty());
+    frameWorld.nextFrame();
+    frameWorld.nextFrame();
+    assert(frameWorld.events().getTotal() == 0 && !frameWorld.events().exists<TestEvent>());
+    assert(channel.getFrame() == 4);
+
+    // Sending while iterating is safe, and the new events aren't visited
+    channel.send(1);
+    frameWorld.nextFrame();
+    int visited = 0;
+    for (auto& event: channel)
+    {
+        channel.send(event.value + 1);
+        ++visited;
+    }
+    assert(visited == 1 && channel.size() == 2);
+
+    // Streams have a cursor for each reader
+    auto& stream = frameWorld.events().stream<TestEvent>();
+    assert(&stream != &es::Events::stream<TestEvent>());
+    stream.send(0);
+    auto reader1 = stream.reader();
+    auto reader2 = stream.reader();
+    assert(stream.readers() == 2 && stream.size() == 0);
+    auto capacity = stream.capacity();
+    int sum1 = 0, sum2 = 0;
+    for (int i = 1; i <= 1000; ++i)
+    {
+        stream.send(i);
+        for (auto& event: reader1.read())
+            sum1 += event.value;
+        if (i % 10 == 0)
+        {
+            for (auto& event: reader2.read())
+                sum2 += event.value;
+        }
+    }
+    assert(sum1 == 500500 && sum2 == 500500);
+    assert(stream.capacity() == capacity);
+    assert(reader1.unread() == 0 && stream.size() == 10);
 
+    // A reader that falls behind keeps its events, so the buffer grows
+    {
+        auto slowReader = stream.reader();
+        for (size_t i = 0; i < capacity * 2; ++i)
+            stream.send(1);
+        assert(stream.capacity() > capacity && slowReader.unread() == capacity * 2);
+        auto events = slowReader.read();
+        assert(events.size() == capacity * 2);
+        stream.send(2);
+        int slowSum = 0;
+        for (auto& event: events)
+            slowSum += event.value;
+        assert(slowSum == static_cast<int>(capacity * 2));
+        assert(slowReader.read().size() == 1);
+    }
+    assert(stream.readers() == 2);
+    reader1.read();
+    reader2.read();
+    reader1.read();
+    reader2.read();
+    assert(stream.size() == 0);
+    stream.send(3);
+    assert(frameWorld.events().getTotal() == channel.size() + 1);
+    frameWorld.events().clearAll();
+    assert(reader1.read().empty() && stream.size() == 0);
+    es::EventStream<TestEvent>::Reader movedReader = std::move(reader2);
+    assert(!reader2.valid() && movedReader.valid() && stream.readers() == 2);
+
+    // Worker threads send to their own buffers, which are merged in order
+    es::World workerWorld;
+    const int workers = 4;
+    auto& workerChannel = workerWorld.events().setProducers<TestEvent>(workers);
+    assert(workerChannel.getProducers() == workers);
+    std::vector<std::thread> threads;
+    for (int worker = 0; worker < workers; ++worker)
+    {
+        threads.emplace_back([&workerChannel, worker]{
+            for (int i = 0; i < 1000; ++i)
+                workerChannel.sendFrom(worker, worker * 1000 + i);
+        });
+    }
+    for (auto& thread: threads)
+        thread.join();
+    assert(workerChannel.empty());
+    workerWorld.nextFrame();
+    auto& merged = workerChannel.getPrevious();
+    assert(merged.size() == workers * 1000);
+    for (size_t i = 0; i < merged.size(); ++i)
+        assert(merged[i].value == static_cast<int>(i));
+    workerChannel.sendFrom(1, 5);
+    workerChannel.send(4);
+    workerWorld.events().sync();
+    assert(workerChannel.getCurrent().size() == 2 && workerChannel.getCurrent().back().value == 5);
+
+    // Targeted events are found by their entity, starting the next frame
+    es::World targetWorld;
+    auto& targetEvents = targetWorld.events();
+    auto& targetChannel = targetEvents.targeted<TestEvent>();
+    std::vector<es::ID> targetIds;
+    for (int i = 0; i < 100; ++i)
+        targetIds.push_back(targetWorld.create().getId());
+    for (int i = 0; i < 1000; ++i)
+        targetEvents.sendTo<TestEvent>(targetIds[(i * 37) % 100], i);
+    targetEvents.sendTo(targetIds[5], TestEvent(-1));
+    assert(targetChannel.get(targetIds[5]).empty());
+    assert(targetEvents.getTotal() == 1001);
+    targetWorld.nextFrame();
+    assert(targetChannel.getPrevious().size() == 1001);
+    assert(std::is_sorted(targetChannel.getPreviousTargets().begin(), targetChannel.getPreviousTargets().end()));
+    for (int target = 0; target < 100; ++target)
+    {
+        auto received = targetChannel.get(targetIds[target]);
+        assert(received.size() == (target == 5 ? 11 : 10));
+        int last = -1;
+        for (auto& event: received)
+        {
+            // Each entity's events are still in the order they were sent
+            assert(event.value == -1 || ((event.value * 37) % 100 == target && event.value > last));
+            if (event.value != -1)
+                last = event.value;
+        }
+    }
+    assert(targetChannel.get(es::invalidId).empty());
+    targetWorld.nextFrame();
+    assert(targetChannel.get(targetIds[0]).empty() && targetEvents.getTotal() == 0);
+    targetEvents.sendTo<TestEvent>(targetIds[0], 1);
+    targetEvents.clearAll();
+    targetWorld.nextFrame();
+    assert(targetChannel.getPrevious().empty());
+
+    // Delayed events are sent through the channel when their frame starts
+    es::World timerWorld;
+    auto& timerEvents = timerWorld.events();
+    auto& timerChannel = timerEvents.channel<TestEvent>();
+    timerEvents.sendAfter<TestEvent>(2, 20);
+    timerEvents.sendAfter(1, TestEvent(10));
+    auto cancelled = timerEvents.sendAfter<TestEvent>(1, 11);
+    timerEvents.sendAfter<TestEvent>(1, 12);
+    assert(timerEvents.sendAfter<TestEvent>(0, 0) == es::invalidId);
+    assert(timerChannel.getDelayed() == 4 && timerEvents.getTimers().size() == 4);
+    assert(timerEvents.cancelTimer(cancelled) && !timerEvents.cancelTimer(cancelled));
+    assert(timerChannel.getDelayed() == 3);
+    timerWorld.nextFrame();
+    assert(timerChannel.getCurrent().size() == 2);
+    assert(timerChannel.getCurrent()[0].value == 10 && timerChannel.getCurrent()[1].value == 12);
+    timerWorld.nextFrame();
+    assert(timerChannel.getCurrent().size() == 1 && timerChannel.getCurrent()[0].value == 20);
+    assert(timerChannel.getDelayed() == 0 && timerEvents.getTimers().size() == 0);
+
+    // Long delays move down through the levels of the wheel, and still expire in order
+    std::vector<uint64_t> delays {64, 65, 4095, 4096, 4097, 300000, 63, 1, 262144, 128};
+    for (auto delay: delays)
+        timerEvents.sendAfter<TestEvent>(delay, static_cast<int>(delay));
+    std::sort(delays.begin(), delays.end());
+    std::vector<uint64_t> expired;
+    uint64_t startFrame = timerEvents.getFrame();
+    while (timerEvents.getTimers().size() > 0)
+    {
+        timerWorld.nextFrame();
+        for (auto& event: timerChannel.getCurrent())
+        {
+            assert(timerEvents.getFrame() - startFrame == static_cast<uint64_t>(event.value));
+            expired.push_back(event.value);
+        }
+    }
+    assert(expired == delays);
+
+    // Without any timers, frames don't visit the wheel
+    es::TimingWheel wheel;
+    wheel.advance(1000000000);
+    assert(wheel.getTick() == 1000000000);
+
+    // Global events only move to the next frame when asked to
+    es::Events::send(TestEvent(5));
+    es::Events::nextFrame();
+    assert(es::Events::getTotal() == 1);
+    es::Events::nextFrame();
+    assert(es::Events::getTotal() == 0);
+
+    // Worlds on different threads don't need any synchronization
+    auto runWorld = [](int& result){
+        es::World world;
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            auto ent = world.copy("Player");
+            ent << Velocity(1, 1) << Health{frame};
+            for (auto e: world.query<Position, Velocity>(world.frameMemory()))
+                e.at<Position>()->x += e.at<Velocity>()->x;
+            world.events().send(TestEvent(frame));
+            if (frame % 10 == 9)
+                world.destroy(world.query<Health>().front().getId());
+            result = static_cast<int>(world.size() + world.events().getTotal());
+            world.nextFrame();
+        }
+    };
+    int result1 = 0, result2 = 0;
+    std::thread thread1(runWorld, std::ref(result1));
+    std::thread thread2(runWorld, std::ref(result2));
+    thread1.join();
+    thread2.join();
+    assert(result1 == 92);
+    assert(result1 == result2);
 }
 
 void systemTests()
@@ -906,6 +2062,290 @@ void systemTests()
     auto sys1 = systems.getSystem<System1>();
     assert(sys1);
     sys1->test();
+    assert(sys1->hasTime());
+
+    // Update policies
+    es::SystemContainer policySystems(world);
+    policySystems.add<RecordingSystem<0>>();
+    policySystems.add<RecordingSystem<1>>();
+    policySystems.add<RecordingSystem<2>>();
+    policySystems.add<RecordingSystem<3>>();
+    policySystems.add<RecordingSystem<4>>();
+    policySystems.add<BudgetSystem>();
+    policySystems.setPolicy<RecordingSystem<1>>(es::UpdatePolicy::fixedStep(0.5f, 3));
+    policySystems.setPolicy<RecordingSystem<2>>(es::UpdatePolicy::everyNFrames(4));
+    policySystems.setPolicy<RecordingSystem<3>>(es::UpdatePolicy::everyNFrames(4));
+    policySystems.setPolicy<RecordingSystem<4>>(es::UpdatePolicy::everyNFrames(2));
+    policySystems.setPolicy<BudgetSystem>(es::UpdatePolicy::timeBudget(0.001f));
+    assert(policySystems.getPolicy<RecordingSystem<2>>()->phase == 0);
+    assert(policySystems.getPolicy<RecordingSystem<3>>()->phase == 1);
+    assert(policySystems.getPolicy<RecordingSystem<4>>()->phase == 0);
+    assert(!policySystems.getPolicy<System1>());
+    auto budgetSystem = policySystems.getSystem<BudgetSystem>();
+    budgetSystem->items = 1000000000;
+    for (int frame = 0; frame < 8; ++frame)
+        policySystems.updateAll(0.25f);
+    assert(policySystems.getFrame() == 8);
+
+    // Every frame
+    auto& everyFrame = policySystems.getSystem<RecordingSystem<0>>()->updates;
+    assert(everyFrame.size() == 8 && everyFrame.front() == 0.25f);
+
+    // Fixed steps, with the time that's left kept for the next frame
+    auto& fixed = policySystems.getSystem<RecordingSystem<1>>()->updates;
+    assert(fixed.size() == 4 && fixed.front() == 0.5f);
+    policySystems.updateAll(10.0f);
+    assert(fixed.size() == 7);
+    policySystems.updateAll(0.25f);
+    assert(fixed.size() == 7);
+    policySystems.updateAll(0.25f);
+    assert(fixed.size() == 8);
+
+    // Every 4 frames, with all of the time since the last update, on different frames
+    auto& everyFour = policySystems.getSystem<RecordingSystem<2>>()->updates;
+    auto& everyFourStaggered = policySystems.getSystem<RecordingSystem<3>>()->updates;
+    assert(everyFour.size() == 3 && everyFour[0] == 0.25f && everyFour[1] == 1.0f && everyFour[2] == 10.75f);
+    assert(everyFourStaggered.size() == 3 && everyFourStaggered[0] == 0.5f && everyFourStaggered[2] == 10.75f);
+    assert(policySystems.getSystem<RecordingSystem<4>>()->updates.size() == 6);
+
+    // The budgeted system stops when it runs out of time, and continues next frame
+    assert(budgetSystem->updates == 11 && budgetSystem->next > 0);
+    assert(budgetSystem->next < budgetSystem->items);
+    assert(budgetSystem->hasTime());
+
+    // Triggered systems are only updated when their inputs change
+    es::World triggerWorld;
+    es::SystemContainer triggerSystems(triggerWorld);
+    triggerSystems.add<TriggeredSystem>();
+    auto triggered = triggerSystems.getSystem<TriggeredSystem>();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 1);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 1);
+
+    // Adding components, and changing them through Entity
+    auto triggerEnt = triggerWorld.create();
+    triggerEnt.assign<Health>(50);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 2 && triggered->lastDt == 0.5f);
+    triggerEnt.assign<Position>(1, 2);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 2);
+    triggerEnt.patch<Health>([](Health& health) { health.value -= 10; });
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 3);
+
+    // Replacing the value of an existing component through Entity is tracked too
+    uint64_t assignVersion = triggerWorld.getVersion<Health>();
+    triggerEnt.assign<Health>(30);
+    triggerEnt.emplaceOrReplace<Health>(35);
+    assert(triggerWorld.getVersion<Health>() == assignVersion + 2);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 4);
+    triggerEnt.remove<Health>();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 5);
+
+    // Changes through references aren't tracked, so they need to be counted
+    triggerEnt.assign<Health>(10);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 6);
+    uint64_t healthVersion = triggerWorld.getVersion<Health>();
+    triggerEnt.getPtr<Health>()->value = 5;
+    triggerEnt.at<Health>()->value -= 1;
+    for (auto& health: triggerWorld.getComponents<Health>())
+        health.value += 1;
+    assert(triggerWorld.getVersion<Health>() == healthVersion);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 6);
+    triggerWorld.markChanged<Health>();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 7);
+
+    // Events trigger the system once, in the frame after they were sent
+    triggerWorld.events().send(ResizeEvent{800});
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 7);
+    triggerWorld.nextFrame();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 8);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 8);
+    triggerWorld.nextFrame();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 8);
+    triggerWorld.events().send(ResizeEvent{640});
+    triggerWorld.nextFrame();
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 9);
+
+    // Systems that didn't finish can ask to be updated again
+    triggered->unfinished = true;
+    triggerWorld.markChanged<Health>();
+    triggerSystems.updateAll(0.25f);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 11);
+    triggered->unfinished = false;
+    triggerSystems.updateAll(0.25f);
+    triggerSystems.updateAll(0.25f);
+    assert(triggered->updates == 12);
+
+    // Triggers stay pending until a fixed step system is actually updated
+    es::World stepWorld;
+    es::SystemContainer stepSystems(stepWorld);
+    stepSystems.add<TriggeredSystem>();
+    stepSystems.setPolicy<TriggeredSystem>(es::UpdatePolicy::fixedStep(0.5f));
+    auto stepped = stepSystems.getSystem<TriggeredSystem>();
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 0);
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 1);
+    stepWorld.create() << Health(5);
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 1);
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 2);
+    stepWorld.events().send(ResizeEvent{320});
+    stepWorld.nextFrame();
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 2);
+    stepWorld.nextFrame();
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 3);
+    stepSystems.updateAll(0.25f);
+    stepSystems.updateAll(0.25f);
+    assert(stepped->updates == 3);
+
+    // The deadline is cleared even if the update throws
+    es::World throwWorld;
+    es::SystemContainer throwSystems(throwWorld);
+    throwSystems.add<ThrowingSystem>();
+    throwSystems.setPolicy<ThrowingSystem>(es::UpdatePolicy::timeBudget(0.000001f));
+    auto throwing = throwSystems.getSystem<ThrowingSystem>();
+    throwing->fail = true;
+    bool updateThrew = false;
+    try
+    {
+        throwSystems.updateAll(0.25f);
+    }
+    catch (const std::runtime_error&)
+    {
+        updateThrew = true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert(updateThrew && throwing->hasTime());
+
+    // Coroutine systems continue where they left off in later frames
+    es::World coroutineWorld;
+    es::SystemContainer coroutineSystems(coroutineWorld);
+    coroutineSystems.add<StagedSystem>();
+    auto staged = coroutineSystems.getSystem<StagedSystem>();
+    auto& scheduler = coroutineSystems.getScheduler();
+    coroutineSystems.updateAll(0.25f);
+    assert(staged->runs == 1 && staged->isRunning() && coroutineWorld.size() == 1);
+    coroutineSystems.updateAll(0.25f);
+    coroutineSystems.updateAll(0.25f);
+    assert(coroutineWorld.size() == 3 && staged->dts.size() == 2 && staged->dts[0] == 0.25f);
+
+    // Waiting for a second (the 4th frame starts the wait)
+    for (int frame = 0; frame < 4; ++frame)
+        coroutineSystems.updateAll(0.25f);
+    assert(!staged->waited && scheduler.getTime() == 1.75);
+    coroutineSystems.updateAll(0.25f);
+    assert(staged->waited && staged->countdowns == 1);
+
+    // Awaiting another task, then events
+    coroutineSystems.updateAll(0.25f);
+    coroutineSystems.updateAll(0.25f);
+    assert(staged->countdowns == 2 && scheduler.size() == 1);
+    coroutineWorld.events().send(ResizeEvent{1024});
+    coroutineSystems.updateAll(0.25f);
+    assert(staged->lastWidth == 0);
+    coroutineWorld.nextFrame();
+    coroutineSystems.updateAll(0.25f);
+    assert(staged->lastWidth == 1024);
+
+    // Once run() returns, it is started again
+    assert(staged->runs == 2 && coroutineWorld.size() == 4 && scheduler.size() == 1);
+
+    // Tasks of removed systems are cancelled
+    coroutineSystems.remove<StagedSystem>();
+    assert(scheduler.size() == 0);
+    coroutineSystems.updateAll(0.25f);
+
+    // Tasks started by any system are cancelled when it is destroyed
+    coroutineSystems.add<PulseSystem>();
+    auto pulse = coroutineSystems.getSystem<PulseSystem>();
+    coroutineSystems.updateAll(0.25f);
+    coroutineSystems.updateAll(0.25f);
+    assert(pulse->pulses == 2 && scheduler.size() == 1);
+    coroutineSystems.remove<PulseSystem>();
+    assert(scheduler.size() == 0);
+    coroutineSystems.updateAll(0.25f);
+
+    // Tasks can be started and cancelled directly
+    int ticks = 0;
+    auto ticker = [](int& ticks) -> es::Task {
+        while (true)
+        {
+            ++ticks;
+            co_await es::nextFrame();
+        }
+    };
+    auto tickerId = scheduler.start(ticker(ticks));
+    scheduler.update(0.25f);
+    assert(ticks == 2 && scheduler.isRunning(tickerId));
+    assert(scheduler.cancel(tickerId) && !scheduler.cancel(tickerId));
+    scheduler.update(0.25f);
+    assert(ticks == 2 && scheduler.size() == 0);
+
+    // Exceptions are rethrown by the start() or update() that ran the task
+    auto thrower = [](int frames) -> es::Task {
+        for (int i = 0; i < frames; ++i)
+            co_await es::nextFrame();
+        throw std::runtime_error("Task failed");
+    };
+    bool caught = false;
+    try
+    {
+        scheduler.start(thrower(0));
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    assert(caught && scheduler.size() == 0);
+    caught = false;
+    scheduler.start(thrower(1));
+    scheduler.start(ticker(ticks));
+    try
+    {
+        scheduler.update(0.25f);
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    assert(caught && ticks == 4 && scheduler.size() == 1);
+    scheduler.update(0.25f);
+    assert(ticks == 5);
+
+    // Or by the task that awaited the task that threw
+    int handled = 0;
+    auto catcher = [](auto thrower, int& handled) -> es::Task {
+        try
+        {
+            co_await thrower(1);
+        }
+        catch (const std::runtime_error&)
+        {
+            ++handled;
+        }
+    };
+    scheduler.start(catcher(thrower, handled));
+    scheduler.update(0.25f);
+    assert(handled == 1 && scheduler.size() == 1);
+    scheduler.clear();
 
     std::cout << "System tests passed.\n";
 }
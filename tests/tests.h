@@ -9,6 +9,10 @@
 #include <es/system.h>
 #include <iostream>
 #include <cassert>
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <stdexcept>
 
 namespace esTests
 {
@@ -102,6 +106,106 @@ struct Sprite: public es::Component
     }
 };
 
+// Stored at the index of the entity's ID
+struct Health: public es::Component
+{
+    static constexpr auto name = "Health";
+
+    using Layout = es::DenseLayout;
+
+    int value;
+
+    Health(int value = 100): value{value} {}
+
+    void load(const std::string& str)
+    {
+        es::unpack(str, value);
+    }
+
+    std::string save() const
+    {
+        return es::pack(value);
+    }
+};
+
+// Stored in a hash table by the entity's ID
+// Can't be constructed with a negative value
+struct Fragile: public es::Component
+{
+    static constexpr auto name = "Fragile";
+
+    int value;
+
+    Fragile(int value = 0): value(value)
+    {
+        if (value < 0)
+            throw std::invalid_argument("Fragile: Negative value");
+    }
+};
+
+struct Boss: public es::Component
+{
+    static constexpr auto name = "Boss";
+
+    using Layout = es::HashLayout;
+
+    std::string title;
+
+    Boss(const std::string& title = ""): title(title) {}
+
+    void load(const std::string& str)
+    {
+        title = str;
+    }
+
+    std::string save() const
+    {
+        return title;
+    }
+};
+
+// Owns a buffer, so it can only be moved
+struct Texture: public es::Component
+{
+    static constexpr auto name = "Texture";
+
+    std::unique_ptr<std::vector<unsigned char>> pixels;
+
+    Texture(size_t size = 0): pixels(std::make_unique<std::vector<unsigned char>>(size)) {}
+
+    std::string save() const
+    {
+        return es::pack(pixels->size());
+    }
+};
+
+// Keeps track of the memory allocated through it
+class CountingResource: public std::pmr::memory_resource
+{
+    public:
+        size_t allocated {0};
+        size_t allocations {0};
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment)
+        {
+            allocated += bytes;
+            ++allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment)
+        {
+            allocated -= bytes;
+            std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept
+        {
+            return this == &other;
+        }
+};
+
 class System1: public es::System
 {
     public:
@@ -192,6 +296,141 @@ class System4: public es::System
         std::string str;
 };
 
+// Records the dt of each update (the tag makes different system types)
+template <int Tag>
+class RecordingSystem: public es::System
+{
+    public:
+        void update(float dt)
+        {
+            updates.push_back(dt);
+        }
+
+        std::vector<float> updates;
+};
+
+// Works through items until it runs out of time, and continues next update
+class BudgetSystem: public es::System
+{
+    public:
+        void update(float)
+        {
+            ++updates;
+            for (; next < items && hasTime(); ++next)
+            {
+                volatile double work = 0;
+                for (int i = 0; i < 1000; ++i)
+                    work = work + i;
+            }
+        }
+
+        int items{0};
+        int next{0};
+        int updates{0};
+};
+
+// Throws from its update when it is told to
+class ThrowingSystem: public es::System
+{
+    public:
+        void update(float)
+        {
+            if (fail)
+                throw std::runtime_error("ThrowingSystem: Update failed");
+        }
+
+        bool fail{false};
+};
+
+struct ResizeEvent
+{
+    int width;
+};
+
+// Only updates when health changes, or when the window is resized
+class TriggeredSystem: public es::System
+{
+    public:
+        TriggeredSystem()
+        {
+            triggerOnTrackedChanges<Health>();
+            triggerOnEvents<ResizeEvent>();
+        }
+
+        void update(float dt)
+        {
+            ++updates;
+            lastDt = dt;
+            if (unfinished)
+                requestUpdate();
+        }
+
+        int updates{0};
+        float lastDt{0.0f};
+        bool unfinished{false};
+};
+
+// Spawns entities over a few frames, waits, then waits for a resize event
+class StagedSystem: public es::CoroutineSystem
+{
+    public:
+        es::Task run()
+        {
+            ++runs;
+            for (int i = 0; i < 3; ++i)
+            {
+                world->create();
+                dts.push_back(co_await es::nextFrame());
+            }
+            co_await es::seconds(1.0f);
+            waited = true;
+            co_await countDown(2);
+            auto& events = co_await es::nextEvents(world->events().channel<ResizeEvent>());
+            lastWidth = events.back().width;
+        }
+
+        es::Task countDown(int frames)
+        {
+            for (int i = 0; i < frames; ++i)
+            {
+                ++countdowns;
+                co_await es::nextFrame();
+            }
+        }
+
+        int runs{0};
+        std::vector<float> dts;
+        bool waited{false};
+        int countdowns{0};
+        int lastWidth{0};
+};
+
+// Starts a task that counts frames until the system is destroyed
+class PulseSystem: public es::System
+{
+    public:
+        void update(float)
+        {
+            if (!started)
+            {
+                start(pulse());
+                started = true;
+            }
+        }
+
+        es::Task pulse()
+        {
+            while (true)
+            {
+                ++pulses;
+                co_await es::nextFrame();
+            }
+        }
+
+        int pulses{0};
+        bool started{false};
+};
+
 }
 
 #endif